@@ -70,6 +70,8 @@ struct lpass_cdc_priv {
 	struct clk *lpass_audio_hw_vote;
 	int core_hw_vote_count;
 	int core_audio_vote_count;
+	/* duration of the last register restore of each macro */
+	u32 macro_restore_us[MAX_MACRO];
 
 	/* Entry for version info */
 	struct snd_info_entry *entry;
@@ -104,5 +106,6 @@ int lpass_cdc_get_macro_id(bool va_no_dec_flag, u16 reg);
 extern const struct regmap_config lpass_cdc_regmap_config;
 extern u8 *lpass_cdc_reg_access[MAX_MACRO];
 extern const u16 macro_id_base_offset[MAX_MACRO];
+extern const u16 macro_id_max_offset[MAX_MACRO];
 
 #endif
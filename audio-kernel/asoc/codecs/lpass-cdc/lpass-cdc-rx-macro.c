@@ -1373,10 +1373,7 @@ static int lpass_cdc_rx_macro_mclk_enable(
 			}
 			lpass_cdc_clk_rsc_fs_gen_request(rx_priv->dev,
 							true);
-			regcache_mark_dirty(regmap);
-			regcache_sync_region(regmap,
-					RX_START_OFFSET,
-					RX_MAX_OFFSET);
+			lpass_cdc_macro_regcache_sync(rx_priv->dev, RX_MACRO);
 			regmap_update_bits(regmap,
 				LPASS_CDC_RX_CLK_RST_CTRL_MCLK_CONTROL,
 				0x01, 0x01);
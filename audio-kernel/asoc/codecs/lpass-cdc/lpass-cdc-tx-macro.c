@@ -230,10 +230,7 @@ static int lpass_cdc_tx_macro_mclk_enable(
 		}
 		lpass_cdc_clk_rsc_fs_gen_request(tx_priv->dev,
 					true);
-		regcache_mark_dirty(regmap);
-		regcache_sync_region(regmap,
-				TX_START_OFFSET,
-				TX_MAX_OFFSET);
+		lpass_cdc_macro_regcache_sync(tx_priv->dev, TX_MACRO);
 		if (tx_priv->tx_mclk_users == 0) {
 			regmap_update_bits(regmap,
 				LPASS_CDC_TX_CLK_RST_CTRL_MCLK_CONTROL,
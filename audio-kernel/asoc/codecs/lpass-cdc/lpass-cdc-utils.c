@@ -18,6 +18,14 @@ const u16 macro_id_base_offset[MAX_MACRO] = {
 	WSA2_START_OFFSET,
 };
 
+const u16 macro_id_max_offset[MAX_MACRO] = {
+	TX_MAX_OFFSET,
+	RX_MAX_OFFSET,
+	WSA_MAX_OFFSET,
+	VA_MAX_OFFSET,
+	WSA2_MAX_OFFSET,
+};
+
 int lpass_cdc_get_macro_id(bool va_no_dec_flag, u16 reg)
 {
 	if (reg >= TX_START_OFFSET
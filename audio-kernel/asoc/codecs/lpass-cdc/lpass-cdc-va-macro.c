@@ -53,7 +53,7 @@
 #define LPASS_CDC_VA_TX_AMIC_UNMUTE_DELAY_MS       100
 #define LPASS_CDC_VA_TX_DMIC_HPF_DELAY_MS       300
 #define LPASS_CDC_VA_TX_AMIC_HPF_DELAY_MS       300
-#define MAX_RETRY_ATTEMPTS 500
+#define VA_MCLK_RESET_TIMEOUT_MS 10000
 #define LPASS_CDC_VA_MACRO_SWR_STRING_LEN 80
 #define LPASS_CDC_VA_MACRO_CHILD_DEVICES_MAX 3
 
@@ -136,6 +136,7 @@ struct lpass_cdc_va_macro_priv {
 	bool va_without_decimation;
 	struct clk *lpass_audio_hw_vote;
 	struct mutex mclk_lock;
+	wait_queue_head_t mclk_wq;
 	struct mutex swr_clk_lock;
 	struct mutex wlock;
 	struct snd_soc_component *component;
@@ -279,12 +280,8 @@ static int lpass_cdc_va_macro_mclk_enable(
 		}
 		lpass_cdc_clk_rsc_fs_gen_request(va_priv->dev,
 					      true);
-		if (va_priv->va_mclk_users == 0) {
-			regcache_mark_dirty(regmap);
-			regcache_sync_region(regmap,
-					VA_START_OFFSET,
-					VA_MAX_OFFSET);
-		}
+		if (va_priv->va_mclk_users == 0)
+			lpass_cdc_macro_regcache_sync(va_priv->dev, VA_MACRO);
 		va_priv->va_mclk_users++;
 	} else {
 		if (va_priv->va_mclk_users <= 0) {
@@ -311,6 +308,8 @@ static int lpass_cdc_va_macro_mclk_enable(
 	}
 exit:
 	mutex_unlock(&va_priv->mclk_lock);
+	if (!va_priv->va_mclk_users)
+		wake_up(&va_priv->mclk_wq);
 	return ret;
 }
 
@@ -319,7 +318,6 @@ static int lpass_cdc_va_macro_event_handler(struct snd_soc_component *component,
 {
 	struct device *va_dev = NULL;
 	struct lpass_cdc_va_macro_priv *va_priv = NULL;
-	int retry_cnt = MAX_RETRY_ATTEMPTS;
 	int ret = 0;
 
 	if (!lpass_cdc_va_macro_get_data(component, &va_dev,
@@ -328,21 +326,16 @@ static int lpass_cdc_va_macro_event_handler(struct snd_soc_component *component,
 
 	switch (event) {
 	case LPASS_CDC_MACRO_EVT_WAIT_VA_CLK_RESET:
-		while ((va_priv->va_mclk_users != 0) && (retry_cnt != 0)) {
-			dev_dbg_ratelimited(va_dev, "%s:retry_cnt: %d\n",
-				__func__, retry_cnt);
-			/*
-			 * Userspace takes 10 seconds to close
-			 * the session when pcm_start fails due to concurrency
-			 * with PDR/SSR. Loop and check every 20ms till 10
-			 * seconds for va_mclk user count to get reset to 0
-			 * which ensures userspace teardown is done and SSR
-			 * powerup seq can proceed.
-			 */
-			msleep(20);
-			retry_cnt--;
-		}
-		if (retry_cnt == 0)
+		/*
+		 * Userspace takes 10 seconds to close
+		 * the session when pcm_start fails due to concurrency
+		 * with PDR/SSR. Wait up to 10 seconds for va_mclk user
+		 * count to get reset to 0 which ensures userspace
+		 * teardown is done and SSR powerup seq can proceed.
+		 */
+		if (!wait_event_timeout(va_priv->mclk_wq,
+				!va_priv->va_mclk_users,
+				msecs_to_jiffies(VA_MCLK_RESET_TIMEOUT_MS)))
 			dev_err(va_dev,
 				"%s: va_mclk_users non-zero, SSR fail!!\n",
 				__func__);
@@ -2552,6 +2545,7 @@ static int lpass_cdc_va_macro_probe(struct platform_device *pdev)
 	va_priv->pre_dev_up = true;
 
 	mutex_init(&va_priv->mclk_lock);
+	init_waitqueue_head(&va_priv->mclk_wq);
 	mutex_init(&va_priv->wlock);
 	dev_set_drvdata(&pdev->dev, va_priv);
 	lpass_cdc_va_macro_init_ops(&ops, va_io_base);
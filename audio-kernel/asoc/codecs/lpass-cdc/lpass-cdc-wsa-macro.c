@@ -903,10 +903,7 @@ static int lpass_cdc_wsa_macro_mclk_enable(
 			}
 			lpass_cdc_clk_rsc_fs_gen_request(wsa_priv->dev,
 						  true);
-			regcache_mark_dirty(regmap);
-			regcache_sync_region(regmap,
-					WSA_START_OFFSET,
-					WSA_MAX_OFFSET);
+			lpass_cdc_macro_regcache_sync(wsa_priv->dev, WSA_MACRO);
 			/* 9.6MHz MCLK, set value 0x00 if other frequency */
 			regmap_update_bits(regmap,
 				LPASS_CDC_WSA_TOP_FREQ_MCLK, 0x01, 0x01);
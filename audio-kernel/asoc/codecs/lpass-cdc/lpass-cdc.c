@@ -10,6 +10,7 @@
 #include <linux/platform_device.h>
 #include <linux/printk.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 #include <linux/kernel.h>
 #include <linux/clk.h>
 #include <soc/snd_event.h>
@@ -789,6 +790,57 @@ int lpass_cdc_get_version(struct device *dev)
 }
 EXPORT_SYMBOL(lpass_cdc_get_version);
 
+static int lpass_cdc_macro_sync(struct lpass_cdc_priv *priv, u16 macro_id)
+{
+	ktime_t begin;
+	int ret;
+
+	begin = ktime_get();
+	regcache_mark_dirty(priv->regmap);
+	ret = regcache_sync_region(priv->regmap, macro_id_base_offset[macro_id],
+				   macro_id_max_offset[macro_id]);
+	priv->macro_restore_us[macro_id] =
+			(u32)ktime_us_delta(ktime_get(), begin);
+	trace_printk("%s: macro %d restore, %u us, ret %d\n",
+		__func__, macro_id, priv->macro_restore_us[macro_id], ret);
+	dev_dbg(priv->dev, "%s: macro %d restore, %u us, ret %d\n",
+		__func__, macro_id, priv->macro_restore_us[macro_id], ret);
+	return ret;
+}
+
+/**
+ * lpass_cdc_macro_regcache_sync - Restore macro registers from regcache
+ *
+ * @dev: macro device ptr.
+ * @macro_id: ID of macro calling this API.
+ *
+ * Marks the regcache dirty and syncs the register region of the macro,
+ * recording how long the restore took.
+ *
+ * Returns 0 on success or error on failure.
+ */
+int lpass_cdc_macro_regcache_sync(struct device *dev, u16 macro_id)
+{
+	struct lpass_cdc_priv *priv;
+
+	if (!dev) {
+		pr_err("%s: dev is null\n", __func__);
+		return -EINVAL;
+	}
+	if (!lpass_cdc_is_valid_child_dev(dev) || macro_id >= MAX_MACRO) {
+		dev_err(dev, "%s: invalid macro %d\n", __func__, macro_id);
+		return -EINVAL;
+	}
+	priv = dev_get_drvdata(dev->parent);
+	if (!priv) {
+		dev_err(dev, "%s: priv is null\n", __func__);
+		return -EINVAL;
+	}
+
+	return lpass_cdc_macro_sync(priv, macro_id);
+}
+EXPORT_SYMBOL(lpass_cdc_macro_regcache_sync);
+
 static ssize_t lpass_cdc_version_read(struct snd_info_entry *entry,
 				   void *file_private_data,
 				   struct file *file,
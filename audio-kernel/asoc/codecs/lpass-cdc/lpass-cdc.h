@@ -106,6 +106,7 @@ int lpass_cdc_register_event_listener(struct snd_soc_component *component,
 				   bool enable);
 void lpass_cdc_wsa_pa_on(struct device *dev, bool adie_lb);
 bool lpass_cdc_check_core_votes(struct device *dev);
+int lpass_cdc_macro_regcache_sync(struct device *dev, u16 macro_id);
 int lpass_cdc_tx_mclk_enable(struct snd_soc_component *c, bool enable);
 int lpass_cdc_get_version(struct device *dev);
 int lpass_cdc_dmic_clk_enable(struct snd_soc_component *component,
@@ -194,6 +195,12 @@ static inline bool lpass_cdc_check_core_votes(struct device *dev)
 	return false;
 }
 
+static inline int lpass_cdc_macro_regcache_sync(struct device *dev,
+						u16 macro_id)
+{
+	return 0;
+}
+
 static int lpass_cdc_get_version(struct device *dev)
 {
 	return 0;
@@ -9,8 +9,12 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/sched.h>
-#include <linux/delay.h>
 #include <linux/jiffies.h>
+#include <linux/kref.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/err.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <ipc/gpr-lite.h>
@@ -21,191 +25,246 @@
 
 #define TIMEOUT_MS 500
 #define MAX_RETRY_COUNT 3
-#define APM_READY_WAIT_DURATION 2
 
 struct audio_prm {
 	struct gpr_device *adev;
-	wait_queue_head_t wait;
 	struct mutex lock;
-	bool resp_received;
-	atomic_t state;
-	atomic_t status;
+	atomic_t next_token;
+	struct work_struct apm_ready_work;
 	bool is_adsp_up;
 };
 
+/*
+ * One PRM command in flight. The submitter and the response callback each
+ * hold a reference. A waiter that times out cancels the gpr command and
+ * drops the callback reference as well, unless the response raced in.
+ */
+struct audio_prm_req {
+	struct kref ref;
+	struct completion done;
+	uint32_t token;
+	uint32_t opcode;
+	int status;
+	ktime_t submit_time;
+};
+
 static struct audio_prm g_prm;
 
 static bool is_apm_ready_check_done = false;
 
-static int audio_prm_callback(struct gpr_device *adev, void *data)
+static void audio_prm_req_release(struct kref *ref)
 {
-	struct gpr_hdr *hdr = (struct gpr_hdr *)data;
-	uint32_t *payload =  GPR_PKT_GET_PAYLOAD(uint32_t, data);
+	kfree(container_of(ref, struct audio_prm_req, ref));
+}
+
+static struct audio_prm_req *audio_prm_req_alloc(void)
+{
+	struct audio_prm_req *req;
+
+	req = kzalloc(sizeof(*req), GFP_KERNEL);
+	if (!req)
+		return NULL;
 
-	//dev_err(&adev->dev, "%s: Payload %x", __func__, hdr->opcode);
-	switch (hdr->opcode) {
+	kref_init(&req->ref);
+	init_completion(&req->done);
+	return req;
+}
+
+static int audio_prm_rsp_status(struct gpr_pkt *rsp)
+{
+	uint32_t *payload = GPR_PKT_GET_PAYLOAD(uint32_t, rsp);
+
+	if (GPR_PKT_GET_PAYLOAD_BYTE_SIZE(rsp->hdr.header) <
+	    2 * sizeof(uint32_t)) {
+		pr_err("%s: short response opcode 0x%x\n", __func__,
+			rsp->hdr.opcode);
+		return -EINVAL;
+	}
+
+	switch (rsp->hdr.opcode) {
 	case GPR_IBASIC_RSP_RESULT:
-		pr_err("%s: Failed response received",__func__);
-		atomic_set(&g_prm.status, payload[1]);
-		g_prm.resp_received = true;
-		break;
 	case PRM_CMD_RSP_REQUEST_HW_RSC:
 	case PRM_CMD_RSP_RELEASE_HW_RSC:
-		/* payload[1] contains the error status for response */
+		/*
+		 * payload[0] contains the opcode or param_ID the response is
+		 * for and payload[1] the error status.
+		 */
 		if (payload[1] != 0) {
-			atomic_set(&g_prm.status, payload[1]);
 			pr_err("%s: cmd = 0x%x returned error = 0x%x\n",
 				__func__, payload[0], payload[1]);
+			return -EINVAL;
 		}
-		g_prm.resp_received = true;
-		/* payload[0] contains the param_ID for response */
-		switch (payload[0]) {
-		case PARAM_ID_RSC_AUDIO_HW_CLK:
-		case PARAM_ID_RSC_LPASS_CORE:
-		case PARAM_ID_RSC_HW_CORE:
-			if (payload[1] != 0)
-				pr_err("%s: PRM command failed with error %d\n",
-					__func__, payload[1]);
-			atomic_set(&g_prm.state, payload[1]);
-			break;
-		default:
-			pr_err("%s: hit default case",__func__);
-			break;
-		};
+		return 0;
 	default:
-		break;
-	};
-	if (g_prm.resp_received)
-		wake_up(&g_prm.wait);
+		pr_err("%s: unexpected response opcode 0x%x\n", __func__,
+			rsp->hdr.opcode);
+		return -EINVAL;
+	}
+}
+
+/* Called from the gpr receive context with the response matching the token */
+static void audio_prm_rsp_cb(struct gpr_device *adev, struct gpr_pkt *rsp,
+			     int status, void *priv)
+{
+	struct audio_prm_req *req = priv;
+
+	if (!status)
+		status = audio_prm_rsp_status(rsp);
+	else
+		pr_err("%s: token 0x%x opcode 0x%x failed %d\n", __func__,
+			req->token, req->opcode, status);
+
+	req->status = status;
+	pr_debug("%s: token 0x%x opcode 0x%x status %d after %lld us\n",
+		__func__, req->token, req->opcode, status,
+		ktime_us_delta(ktime_get(), req->submit_time));
+
+	complete(&req->done);
+	kref_put(&req->ref, audio_prm_req_release);
+}
+
+static int audio_prm_callback(struct gpr_device *adev, void *data)
+{
+	struct gpr_hdr *hdr = (struct gpr_hdr *)data;
+
+	/*
+	 * Responses to PRM commands are matched by token and completed
+	 * through audio_prm_rsp_cb(), anything reaching here is either
+	 * unsolicited or arrived after its command timed out or was flushed.
+	 */
+	dev_dbg(&adev->dev, "%s: unmatched opcode 0x%x token 0x%x\n",
+		__func__, hdr->opcode, hdr->token);
 	return 0;
 }
 
-static int prm_gpr_send_pkt(struct gpr_pkt *pkt, wait_queue_head_t *wait)
+static void audio_prm_apm_ready_work(struct work_struct *work)
 {
-	int ret = 0;
 	int retry;
 
+	if (is_apm_ready_check_done ||
+	    gpr_get_q6_state() != GPR_SUBSYS_LOADED)
+		return;
+
+	pr_info("%s: apm ready check not done\n", __func__);
+	/* spf_core_is_apm_ready() waits for the APM state itself */
+	for (retry = 0; retry <= MAX_RETRY_COUNT; retry++) {
+		if (spf_core_is_apm_ready())
+			break;
+	}
+
 	mutex_lock(&g_prm.lock);
-	pr_debug("%s: enter",__func__);
+	if (g_prm.is_adsp_up)
+		is_apm_ready_check_done = true;
+	mutex_unlock(&g_prm.lock);
+	pr_info("%s: apm ready check done\n", __func__);
+}
 
-	if (wait)
-		atomic_set(&g_prm.state, 1);
-	atomic_set(&g_prm.status, 0);
+/*
+ * The APM readiness check is started when the ADSP comes up, so commands
+ * normally find it done. Otherwise wait for the check instead of polling.
+ */
+static void audio_prm_wait_apm_ready(void)
+{
+	bool check;
 
+	mutex_lock(&g_prm.lock);
+	check = !is_apm_ready_check_done && g_prm.is_adsp_up &&
+		(gpr_get_q6_state() == GPR_SUBSYS_LOADED);
+	if (check)
+		schedule_work(&g_prm.apm_ready_work);
+	mutex_unlock(&g_prm.lock);
+
+	if (check)
+		flush_work(&g_prm.apm_ready_work);
+}
+
+/*
+ * Queue @pkt under a new token. On success the response callback owns an
+ * extra reference of @req that it drops once the command completed.
+ */
+static int audio_prm_submit(struct gpr_pkt *pkt, struct audio_prm_req *req)
+{
+	int ret;
+
+	mutex_lock(&g_prm.lock);
 	if (g_prm.adev == NULL) {
 		pr_err("%s: apr is unregistered\n", __func__);
 		mutex_unlock(&g_prm.lock);
 		return -ENODEV;
 	}
-	if (!is_apm_ready_check_done && g_prm.is_adsp_up &&
-			(gpr_get_q6_state() == GPR_SUBSYS_LOADED)) {
-		pr_info("%s: apm ready check not done\n", __func__);
-		retry = 0;
-		while (!spf_core_is_apm_ready() && retry < MAX_RETRY_COUNT) {
-			msleep(APM_READY_WAIT_DURATION);
-			++retry;
-		}
-		is_apm_ready_check_done = true;
-		pr_info("%s: apm ready check done\n", __func__);
-	}
-	g_prm.resp_received = false;
-	ret = gpr_send_pkt(g_prm.adev, pkt);
+
+	do {
+		req->token = atomic_inc_return(&g_prm.next_token);
+	} while (!req->token);
+	pkt->hdr.token = req->token;
+	req->opcode = pkt->hdr.opcode;
+	req->submit_time = ktime_get();
+
+	kref_get(&req->ref);
+	ret = gpr_send_pkt_async(g_prm.adev, pkt, audio_prm_rsp_cb, req);
 	if (ret < 0) {
 		pr_err("%s: packet not transmitted %d\n", __func__, ret);
-		mutex_unlock(&g_prm.lock);
-		return ret;
-	}
-
-	if (wait) {
-		ret = wait_event_timeout(g_prm.wait,
-				(g_prm.resp_received),
-				msecs_to_jiffies(2 * TIMEOUT_MS));
-		if (!ret) {
-			pr_err("%s: pkt send timeout\n", __func__);
-			ret = -ETIMEDOUT;
-		} else if (atomic_read(&g_prm.status) > 0) {
-			pr_err("%s: DSP returned error %d\n", __func__,
-				atomic_read(&g_prm.status));
-			ret = -EINVAL;
-		} else {
-			ret = 0;
-		}
+		kref_put(&req->ref, audio_prm_req_release);
 	}
-	pr_debug("%s: exit",__func__);
 	mutex_unlock(&g_prm.lock);
 	return ret;
 }
 
-/**
- */
-int audio_prm_set_lpass_hw_core_req(struct clk_cfg *cfg, uint32_t hw_core_id, uint8_t enable)
+static int prm_gpr_send_pkt(struct gpr_pkt *pkt)
 {
-	struct gpr_pkt *pkt;
-        prm_cmd_request_hw_core_t prm_rsc_request;
-        int ret = 0;
-        uint32_t size;
-
-        size = GPR_HDR_SIZE + sizeof(prm_cmd_request_hw_core_t);
-        pkt = kzalloc(size,  GFP_KERNEL);
-        if (!pkt)
-                return -ENOMEM;
-
-        pkt->hdr.header = GPR_SET_FIELD(GPR_PKT_VERSION, GPR_PKT_VER) |
-                         GPR_SET_FIELD(GPR_PKT_HEADER_SIZE, GPR_PKT_HEADER_WORD_SIZE_V) |
-                         GPR_SET_FIELD(GPR_PKT_PACKET_SIZE, size);
-
-        pkt->hdr.src_port = GPR_SVC_ASM;
-        pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
-        pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
-        pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-        pkt->hdr.token = 0; /* TBD */
-	if (enable)
-		pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
-	else
-		pkt->hdr.opcode = PRM_CMD_RELEASE_HW_RSC;
-
-        //pr_err("%s: clk_id %d size of cmd_req %ld \n",__func__, cfg->clk_id, sizeof(prm_cmd_request_hw_core_t));
-
-        prm_rsc_request.payload_header.payload_address_lsw = 0;
-        prm_rsc_request.payload_header.payload_address_msw = 0;
-        prm_rsc_request.payload_header.mem_map_handle = 0;
-        prm_rsc_request.payload_header.payload_size = sizeof(prm_cmd_request_hw_core_t) - sizeof(apm_cmd_header_t);
-
-        /** Populate the param payload */
-        prm_rsc_request.module_payload_0.module_instance_id = PRM_MODULE_INSTANCE_ID;
-        prm_rsc_request.module_payload_0.error_code = 0;
-        prm_rsc_request.module_payload_0.param_id = PARAM_ID_RSC_HW_CORE;
-        prm_rsc_request.module_payload_0.param_size =
-                sizeof(prm_cmd_request_hw_core_t) - sizeof(apm_cmd_header_t) - sizeof(apm_module_param_data_t);
-
+	struct audio_prm_req *req;
+	int ret;
 
-        prm_rsc_request.hw_core_id = hw_core_id; // HW_CORE_ID_LPASS;
+	pr_debug("%s: enter",__func__);
+	audio_prm_wait_apm_ready();
 
-        memcpy(&pkt->payload, &prm_rsc_request, sizeof(prm_cmd_request_hw_core_t));
+	req = audio_prm_req_alloc();
+	if (!req)
+		return -ENOMEM;
 
-        ret = prm_gpr_send_pkt(pkt, &g_prm.wait);
+	ret = audio_prm_submit(pkt, req);
+	if (ret < 0)
+		goto done;
 
-        kfree(pkt);
-        return ret;
+	if (!wait_for_completion_timeout(&req->done,
+					 msecs_to_jiffies(2 * TIMEOUT_MS))) {
+		pr_err("%s: pkt send timeout\n", __func__);
+		ret = -ETIMEDOUT;
+		/* A late response is then dropped by audio_prm_callback() */
+		mutex_lock(&g_prm.lock);
+		if (g_prm.adev &&
+		    !gpr_cancel_pkt_async(g_prm.adev, req->token, req))
+			kref_put(&req->ref, audio_prm_req_release);
+		mutex_unlock(&g_prm.lock);
+	} else if (req->status < 0) {
+		pr_err("%s: DSP returned error %d\n", __func__, req->status);
+		ret = req->status;
+	}
+done:
+	kref_put(&req->ref, audio_prm_req_release);
+	pr_debug("%s: exit",__func__);
+	return ret;
 }
-EXPORT_SYMBOL(audio_prm_set_lpass_hw_core_req);
 
-/**
- * prm_set_lpass_clk_cfg() - Set PRM clock
- *
- * Return: 0 if clock set is success
+/*
+ * Allocate a PRM resource command carrying a single module param of
+ * @param_size bytes, the param data is returned through @param.
  */
-static int audio_prm_set_lpass_clk_cfg_req(struct clk_cfg *cfg)
+static struct gpr_pkt *audio_prm_alloc_rsc_pkt(uint32_t opcode,
+					       uint32_t param_id,
+					       uint32_t param_size,
+					       void **param)
 {
 	struct gpr_pkt *pkt;
-	prm_cmd_request_rsc_t prm_rsc_request;
-	int ret = 0;
+	apm_cmd_header_t *payload_header;
+	apm_module_param_data_t *module_payload;
 	uint32_t size;
 
-	size = GPR_HDR_SIZE + sizeof(prm_cmd_request_rsc_t);
-	pkt = kzalloc(size,  GFP_KERNEL);
+	size = GPR_HDR_SIZE + sizeof(apm_cmd_header_t) +
+		sizeof(apm_module_param_data_t) + param_size;
+	pkt = kzalloc(size, GFP_KERNEL);
 	if (!pkt)
-		return -ENOMEM;
+		return NULL;
 
 	pkt->hdr.header = GPR_SET_FIELD(GPR_PKT_VERSION, GPR_PKT_VER) |
 			 GPR_SET_FIELD(GPR_PKT_HEADER_SIZE, GPR_PKT_HEADER_WORD_SIZE_V) |
@@ -215,87 +274,100 @@ static int audio_prm_set_lpass_clk_cfg_req(struct clk_cfg *cfg)
 	pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
 	pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
 	pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-	pkt->hdr.token = 0; /* TBD */
-	pkt->hdr.opcode = PRM_CMD_REQUEST_HW_RSC;
-
-	//pr_err("%s: clk_id %d size of cmd_req %ld \n",__func__, cfg->clk_id, sizeof(prm_cmd_request_rsc_t));
+	pkt->hdr.opcode = opcode;
 
-	prm_rsc_request.payload_header.payload_address_lsw = 0;
-	prm_rsc_request.payload_header.payload_address_msw = 0;
-	prm_rsc_request.payload_header.mem_map_handle = 0;
-	prm_rsc_request.payload_header.payload_size = sizeof(prm_cmd_request_rsc_t) - sizeof(apm_cmd_header_t);
+	payload_header = (apm_cmd_header_t *)&pkt->payload;
+	payload_header->payload_size = size - GPR_HDR_SIZE -
+					sizeof(apm_cmd_header_t);
 
 	/** Populate the param payload */
-	prm_rsc_request.module_payload_0.module_instance_id = PRM_MODULE_INSTANCE_ID;
-	prm_rsc_request.module_payload_0.error_code = 0;
-	prm_rsc_request.module_payload_0.param_id = PARAM_ID_RSC_AUDIO_HW_CLK;
-	prm_rsc_request.module_payload_0.param_size =
-		sizeof(prm_cmd_request_rsc_t) - sizeof(apm_cmd_header_t) - sizeof(apm_module_param_data_t);
-
-	prm_rsc_request.num_clk_id_t.num_clock_id = MAX_AUD_HW_CLK_NUM_REQ;
-
-	prm_rsc_request.clock_ids_t[0].clock_id = cfg->clk_id;
-	prm_rsc_request.clock_ids_t[0].clock_freq = cfg->clk_freq_in_hz;
-	prm_rsc_request.clock_ids_t[0].clock_attri = cfg->clk_attri;
-	prm_rsc_request.clock_ids_t[0].clock_root = cfg->clk_root;
+	module_payload = (apm_module_param_data_t *)(payload_header + 1);
+	module_payload->module_instance_id = PRM_MODULE_INSTANCE_ID;
+	module_payload->param_id = param_id;
+	module_payload->param_size = param_size;
 
-	memcpy(&pkt->payload, &prm_rsc_request, sizeof(prm_cmd_request_rsc_t));
-
-	ret = prm_gpr_send_pkt(pkt, &g_prm.wait);
-
-	kfree(pkt);
-	return ret;
+	*param = module_payload + 1;
+	return pkt;
 }
 
-static int audio_prm_set_lpass_clk_cfg_rel(struct clk_cfg *cfg)
+static struct gpr_pkt *audio_prm_alloc_hw_core_pkt(uint32_t hw_core_id,
+						   uint8_t enable)
 {
+	struct gpr_pkt *pkt;
+	uint32_t *core_id;
 
-        struct gpr_pkt *pkt;
-        prm_cmd_release_rsc_t prm_rsc_release;
-        int ret = 0;
-        uint32_t size;
-
-        size = GPR_HDR_SIZE + sizeof(prm_cmd_release_rsc_t);
-        pkt = kzalloc(size,  GFP_KERNEL);
-        if (!pkt)
-                return -ENOMEM;
-
-        pkt->hdr.header = GPR_SET_FIELD(GPR_PKT_VERSION, GPR_PKT_VER) |
-                         GPR_SET_FIELD(GPR_PKT_HEADER_SIZE, GPR_PKT_HEADER_WORD_SIZE_V) |
-                         GPR_SET_FIELD(GPR_PKT_PACKET_SIZE, size);
-
-        pkt->hdr.src_port = GPR_SVC_ASM;
-        pkt->hdr.dst_port = PRM_MODULE_INSTANCE_ID;
-        pkt->hdr.dst_domain_id = GPR_IDS_DOMAIN_ID_ADSP_V;
-        pkt->hdr.src_domain_id = GPR_IDS_DOMAIN_ID_APPS_V;
-        pkt->hdr.token = 0; /* TBD */
-        pkt->hdr.opcode = PRM_CMD_RELEASE_HW_RSC;
-
-        //pr_err("%s: clk_id %d size of cmd_req %ld \n",__func__, cfg->clk_id, sizeof(prm_cmd_release_rsc_t));
+	pkt = audio_prm_alloc_rsc_pkt(enable ? PRM_CMD_REQUEST_HW_RSC :
+					       PRM_CMD_RELEASE_HW_RSC,
+				      PARAM_ID_RSC_HW_CORE,
+				      sizeof(*core_id), (void **)&core_id);
+	if (!pkt)
+		return ERR_PTR(-ENOMEM);
 
-        prm_rsc_release.payload_header.payload_address_lsw = 0;
-        prm_rsc_release.payload_header.payload_address_msw = 0;
-        prm_rsc_release.payload_header.mem_map_handle = 0;
-        prm_rsc_release.payload_header.payload_size = sizeof(prm_cmd_release_rsc_t) - sizeof(apm_cmd_header_t);
+	*core_id = hw_core_id;
+	return pkt;
+}
 
-        /** Populate the param payload */
-        prm_rsc_release.module_payload_0.module_instance_id = PRM_MODULE_INSTANCE_ID;
-        prm_rsc_release.module_payload_0.error_code = 0;
-        prm_rsc_release.module_payload_0.param_id = PARAM_ID_RSC_AUDIO_HW_CLK;
-        prm_rsc_release.module_payload_0.param_size =
-                sizeof(prm_cmd_release_rsc_t) - sizeof(apm_cmd_header_t) - sizeof(apm_module_param_data_t);
+/*
+ * PARAM_ID_RSC_AUDIO_HW_CLK carries a clock count followed by the clock
+ * entries, a release only needs the clock id.
+ */
+static struct gpr_pkt *audio_prm_alloc_clk_pkt(struct clk_cfg *clk,
+					       uint8_t enable)
+{
+	struct gpr_pkt *pkt;
+	audio_hw_clk_cfg_req_param_t *num_clk_id;
+	audio_hw_clk_cfg_t *clk_req;
+	audio_hw_clk_rel_cfg_t *clk_rel;
+	uint32_t clk_size;
+
+	clk_size = enable ? sizeof(audio_hw_clk_cfg_t) :
+			    sizeof(audio_hw_clk_rel_cfg_t);
+	pkt = audio_prm_alloc_rsc_pkt(enable ? PRM_CMD_REQUEST_HW_RSC :
+					       PRM_CMD_RELEASE_HW_RSC,
+				      PARAM_ID_RSC_AUDIO_HW_CLK,
+				      sizeof(*num_clk_id) + clk_size,
+				      (void **)&num_clk_id);
+	if (!pkt)
+		return ERR_PTR(-ENOMEM);
 
-        prm_rsc_release.num_clk_id_t.num_clock_id = MAX_AUD_HW_CLK_NUM_REQ;
+	num_clk_id->num_clock_id = 1;
+	if (!enable) {
+		clk_rel = (audio_hw_clk_rel_cfg_t *)(num_clk_id + 1);
+		clk_rel->clock_id = clk->clk_id;
+		return pkt;
+	}
 
-        prm_rsc_release.clock_ids_t[0].clock_id = cfg->clk_id;
+	clk_req = (audio_hw_clk_cfg_t *)(num_clk_id + 1);
+	clk_req->clock_id = clk->clk_id;
+	clk_req->clock_freq = clk->clk_freq_in_hz;
+	clk_req->clock_attri = clk->clk_attri;
+	clk_req->clock_root = clk->clk_root;
+	return pkt;
+}
 
-        memcpy(&pkt->payload, &prm_rsc_release, sizeof(prm_cmd_release_rsc_t));
+/**
+ * audio_prm_set_lpass_hw_core_req() - Request or release a hw core
+ *
+ * @cfg: unused
+ * @hw_core_id: HW_CORE_ID_LPASS or HW_CORE_ID_DCODEC
+ * @enable: 1 to request, 0 to release
+ *
+ * Return: 0 once the DSP acknowledged the vote, error otherwise.
+ */
+int audio_prm_set_lpass_hw_core_req(struct clk_cfg *cfg, uint32_t hw_core_id, uint8_t enable)
+{
+	struct gpr_pkt *pkt;
+	int ret;
 
-        ret = prm_gpr_send_pkt(pkt, &g_prm.wait);
+	pkt = audio_prm_alloc_hw_core_pkt(hw_core_id, enable);
+	if (IS_ERR(pkt))
+		return PTR_ERR(pkt);
 
-        kfree(pkt);
-        return ret;
+	ret = prm_gpr_send_pkt(pkt);
+	kfree(pkt);
+	return ret;
 }
+EXPORT_SYMBOL(audio_prm_set_lpass_hw_core_req);
 
 /**
  * audio_prm_set_cdc_earpa_duty_cycling_req() - send codec reg values
@@ -382,19 +454,28 @@ int audio_prm_set_cdc_earpa_duty_cycling_req(struct prm_earpa_hw_intf_config *ea
 					earpa_config->ear_pa_pkd_cfg.ear_pa_disable_pkd_reg_addr;
 
 	memcpy(&pkt->payload, &prm_rsc_request_reg_info, sizeof(prm_cmd_request_cdc_duty_cycling_t));
-	ret = prm_gpr_send_pkt(pkt, &g_prm.wait);
+	ret = prm_gpr_send_pkt(pkt);
 	kfree(pkt);
 	return ret;
 }
 EXPORT_SYMBOL(audio_prm_set_cdc_earpa_duty_cycling_req);
 
+/**
+ * audio_prm_set_lpass_clk_cfg() - Set PRM clock
+ *
+ * Return: 0 if clock set is success
+ */
 int audio_prm_set_lpass_clk_cfg (struct clk_cfg *clk, uint8_t enable)
 {
-	int ret = 0;
-	if (enable)
-		ret = audio_prm_set_lpass_clk_cfg_req (clk);
-	else
-		ret = audio_prm_set_lpass_clk_cfg_rel (clk);
+	struct gpr_pkt *pkt;
+	int ret;
+
+	pkt = audio_prm_alloc_clk_pkt(clk, enable);
+	if (IS_ERR(pkt))
+		return PTR_ERR(pkt);
+
+	ret = prm_gpr_send_pkt(pkt);
+	kfree(pkt);
 	return ret;
 }
 EXPORT_SYMBOL(audio_prm_set_lpass_clk_cfg);
@@ -415,6 +496,8 @@ static int audio_prm_service_cb(struct notifier_block *this,
 	case AUDIO_NOTIFIER_SERVICE_UP:
 		mutex_lock(&g_prm.lock);
 		g_prm.is_adsp_up = true;
+		/* check APM readiness before the first vote needs it */
+		schedule_work(&g_prm.apm_ready_work);
 		mutex_unlock(&g_prm.lock);
 		break;
 	default:
@@ -449,10 +532,10 @@ static int audio_prm_probe(struct gpr_device *adev)
 
 	dev_set_drvdata(&adev->dev, &g_prm);
 
+	mutex_lock(&g_prm.lock);
 	g_prm.adev = adev;
-
-	init_waitqueue_head(&g_prm.wait);
 	g_prm.is_adsp_up = true;
+	mutex_unlock(&g_prm.lock);
 	pr_err("%s: prm probe success\n", __func__);
 	return ret;
 }
@@ -466,6 +549,7 @@ static int audio_prm_remove(struct gpr_device *adev)
 	g_prm.is_adsp_up = false;
 	g_prm.adev = NULL;
 	mutex_unlock(&g_prm.lock);
+	cancel_work_sync(&g_prm.apm_ready_work);
 	return ret;
 }
 
@@ -488,20 +572,21 @@ static struct gpr_driver qcom_audio_prm_driver = {
 static int __init audio_prm_module_init(void)
 {
 	int ret;
+
+	mutex_init(&g_prm.lock);
+	INIT_WORK(&g_prm.apm_ready_work, audio_prm_apm_ready_work);
 	ret = gpr_driver_register(&qcom_audio_prm_driver);
 
 	if (ret)
 		pr_err("%s: gpr driver register failed = %d\n", __func__, ret);
 
-	mutex_init(&g_prm.lock);
-
 	return ret;
 }
 
 static void __exit audio_prm_module_exit(void)
 {
-	mutex_destroy(&g_prm.lock);
 	gpr_driver_unregister(&qcom_audio_prm_driver);
+	mutex_destroy(&g_prm.lock);
 }
 
 module_init(audio_prm_module_init);
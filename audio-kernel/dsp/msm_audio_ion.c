@@ -12,6 +12,8 @@
 #include <linux/slab.h>
 #include <linux/mutex.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-buf.h>
 #include <linux/platform_device.h>
@@ -40,11 +42,16 @@
 #define TZ_PIL_CLEAR_PROTECT_MEM_SUBSYS_ID 0x0D
 #define MSM_AUDIO_ION_DRIVER_NAME "msm_audio_ion"
 #define MINOR_NUMBER_COUNT 1
+
+/* Buckets for the dma_buf and fd indexes, sized for a few hundred buffers */
+#define MSM_AUDIO_ION_HASH_BITS 6
+
 struct msm_audio_ion_private {
 	bool smmu_enabled;
 	struct device *cb_dev;
 	u8 device_status;
-	struct list_head alloc_list;
+	/* allocations keyed by dma_buf pointer, under list_mutex */
+	DECLARE_HASHTABLE(alloc_hash, MSM_AUDIO_ION_HASH_BITS);
 	struct mutex list_mutex;
 	u64 smmu_sid_bits;
 	u32 smmu_version;
@@ -63,13 +70,19 @@ struct msm_audio_alloc_data {
 	struct dma_buf *dma_buf;
 	struct dma_buf_attachment *attach;
 	struct sg_table *table;
-	struct list_head list;
+	struct hlist_node hnode;
 };
 
 struct msm_audio_ion_fd_list_private {
 	struct mutex list_mutex;
 	/*list to store fd, phy. addr and handle data */
 	struct list_head fd_list;
+	/*
+	 * fd_list entries indexed by fd and by dma_buf handle. Updates are
+	 * done under list_mutex, lookups only need rcu_read_lock().
+	 */
+	DECLARE_HASHTABLE(fd_hash, MSM_AUDIO_ION_HASH_BITS);
+	DECLARE_HASHTABLE(handle_hash, MSM_AUDIO_ION_HASH_BITS);
 };
 
 static struct msm_audio_ion_fd_list_private msm_audio_ion_fd_list = {0,};
@@ -82,9 +95,49 @@ struct msm_audio_fd_data {
 	dma_addr_t paddr;
 	struct device *dev;
 	struct list_head list;
+	struct hlist_node fd_node;
+	struct hlist_node handle_node;
+	struct rcu_head rcu;
 	bool hyp_assign;
 };
 
+static struct msm_audio_alloc_data *msm_audio_ion_find_alloc(
+	struct msm_audio_ion_private *ion_data, struct dma_buf *dma_buf)
+{
+	struct msm_audio_alloc_data *alloc_data = NULL;
+
+	hash_for_each_possible(ion_data->alloc_hash, alloc_data, hnode,
+			       (unsigned long)dma_buf) {
+		if (alloc_data->dma_buf == dma_buf)
+			return alloc_data;
+	}
+
+	return NULL;
+}
+
+/* Must be called under rcu_read_lock() or the fd list mutex */
+static struct msm_audio_fd_data *msm_audio_find_fd_data(int fd)
+{
+	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
+
+	hash_for_each_possible_rcu(msm_audio_ion_fd_list.fd_hash,
+				   msm_audio_fd_data, fd_node, fd,
+				   lockdep_is_held(&msm_audio_ion_fd_list.list_mutex)) {
+		if (msm_audio_fd_data->fd == fd)
+			return msm_audio_fd_data;
+	}
+
+	return NULL;
+}
+
+static void msm_audio_del_fd_data(struct msm_audio_fd_data *msm_audio_fd_data)
+{
+	list_del(&msm_audio_fd_data->list);
+	hash_del_rcu(&msm_audio_fd_data->fd_node);
+	hash_del_rcu(&msm_audio_fd_data->handle_node);
+	kfree_rcu(msm_audio_fd_data, rcu);
+}
+
 static void msm_audio_ion_add_allocation(
 	struct msm_audio_ion_private *msm_audio_ion_data,
 	struct msm_audio_alloc_data *alloc_data)
@@ -95,8 +148,8 @@ static void msm_audio_ion_add_allocation(
 	 * of allocations is always protected
 	 */
 	mutex_lock(&(msm_audio_ion_data->list_mutex));
-	list_add_tail(&(alloc_data->list),
-		      &(msm_audio_ion_data->alloc_list));
+	hash_add(msm_audio_ion_data->alloc_hash, &alloc_data->hnode,
+		 (unsigned long)alloc_data->dma_buf);
 	mutex_unlock(&(msm_audio_ion_data->list_mutex));
 }
 
@@ -125,13 +178,9 @@ static void *msm_audio_ion_map_kernel(struct dma_buf *dma_buf,
 	 * for mapping kernel virtual address is available.
 	 */
 	mutex_lock(&(ion_data->list_mutex));
-	list_for_each_entry(alloc_data, &(ion_data->alloc_list),
-			    list) {
-		if (alloc_data->dma_buf == dma_buf) {
-			alloc_data->vaddr = addr;
-			break;
-		}
-	}
+	alloc_data = msm_audio_ion_find_alloc(ion_data, dma_buf);
+	if (alloc_data)
+		alloc_data->vaddr = addr;
 	mutex_unlock(&(ion_data->list_mutex));
 
 exit:
@@ -216,42 +265,30 @@ static int msm_audio_dma_buf_unmap(struct dma_buf *dma_buf, struct msm_audio_ion
 {
 	int rc = 0;
 	struct msm_audio_alloc_data *alloc_data = NULL;
-	struct list_head *ptr, *next;
-	bool found = false;
 	struct device *cb_dev = ion_data->cb_dev;
 
 	/*
-	 * Though list_for_each_safe is delete safe, lock
-	 * should be explicitly acquired to avoid race condition
-	 * on adding elements to the list.
+	 * Lock should be explicitly acquired to avoid race
+	 * condition on adding elements to the table.
 	 */
 	mutex_lock(&(ion_data->list_mutex));
-	list_for_each_safe(ptr, next,
-			    &(ion_data->alloc_list)) {
+	alloc_data = msm_audio_ion_find_alloc(ion_data, dma_buf);
+	if (alloc_data) {
+		dma_buf_unmap_attachment(alloc_data->attach,
+					 alloc_data->table,
+					 DMA_BIDIRECTIONAL);
 
-		alloc_data = list_entry(ptr, struct msm_audio_alloc_data,
-					list);
+		dma_buf_detach(alloc_data->dma_buf,
+			       alloc_data->attach);
 
-		if (alloc_data->dma_buf == dma_buf) {
-			found = true;
-			dma_buf_unmap_attachment(alloc_data->attach,
-						 alloc_data->table,
-						 DMA_BIDIRECTIONAL);
+		dma_buf_put(alloc_data->dma_buf);
 
-			dma_buf_detach(alloc_data->dma_buf,
-				       alloc_data->attach);
-
-			dma_buf_put(alloc_data->dma_buf);
-
-			list_del(&(alloc_data->list));
-			kfree(alloc_data);
-			alloc_data = NULL;
-			break;
-		}
+		hash_del(&(alloc_data->hnode));
+		kfree(alloc_data);
 	}
 	mutex_unlock(&(ion_data->list_mutex));
 
-	if (!found) {
+	if (!alloc_data) {
 		dev_err(cb_dev,
 			"%s: cannot find allocation, dma_buf %pK",
 			__func__, dma_buf);
@@ -295,13 +332,9 @@ static int msm_audio_ion_unmap_kernel(struct dma_buf *dma_buf, struct msm_audio_
 	 * for unmapping kernel virtual address is available.
 	 */
 	mutex_lock(&(ion_data->list_mutex));
-	list_for_each_entry(alloc_data, &(ion_data->alloc_list),
-			    list) {
-		if (alloc_data->dma_buf == dma_buf) {
-			vaddr = alloc_data->vaddr;
-			break;
-		}
-	}
+	alloc_data = msm_audio_ion_find_alloc(ion_data, dma_buf);
+	if (alloc_data)
+		vaddr = alloc_data->vaddr;
 	mutex_unlock(&(ion_data->list_mutex));
 
 	if (!vaddr) {
@@ -370,37 +403,34 @@ void msm_audio_fd_list_debug(void)
 
 void msm_audio_update_fd_list(struct msm_audio_fd_data *msm_audio_fd_data)
 {
-	struct msm_audio_fd_data *msm_audio_fd_data1 = NULL;
-
 	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data1,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data1->fd == msm_audio_fd_data->fd) {
-			pr_err("%s fd already present, not updating the list",
-				__func__);
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return;
-		}
+	if (msm_audio_find_fd_data(msm_audio_fd_data->fd)) {
+		pr_err("%s fd already present, not updating the list",
+			__func__);
+		mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+		return;
 	}
 	list_add_tail(&msm_audio_fd_data->list, &msm_audio_ion_fd_list.fd_list);
+	hash_add_rcu(msm_audio_ion_fd_list.fd_hash,
+		     &msm_audio_fd_data->fd_node, msm_audio_fd_data->fd);
+	hash_add_rcu(msm_audio_ion_fd_list.handle_hash,
+		     &msm_audio_fd_data->handle_node,
+		     (unsigned long)msm_audio_fd_data->handle);
 	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
 }
 
 void msm_audio_delete_fd_entry(void *handle)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
-	struct list_head *ptr, *next;
 
 	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_safe(ptr, next,
-			&msm_audio_ion_fd_list.fd_list) {
-		msm_audio_fd_data = list_entry(ptr, struct msm_audio_fd_data,
-					list);
+	hash_for_each_possible(msm_audio_ion_fd_list.handle_hash,
+			       msm_audio_fd_data, handle_node,
+			       (unsigned long)handle) {
 		if (msm_audio_fd_data->handle == handle) {
 			pr_info("%s deleting handle %pK entry from list\n",
 				__func__, handle);
-			list_del(&(msm_audio_fd_data->list));
-			kfree(msm_audio_fd_data);
+			msm_audio_del_fd_data(msm_audio_fd_data);
 			break;
 		}
 	}
@@ -416,21 +446,18 @@ int msm_audio_get_phy_addr(int fd, dma_addr_t *paddr, size_t *pa_len)
 		pr_err("%s Invalid paddr param status %d\n", __func__, status);
 		return status;
 	}
-	pr_info("%s, fd %d\n", __func__, fd);
-	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*paddr = msm_audio_fd_data->paddr;
-			*pa_len = msm_audio_fd_data->plen;
-			status = 0;
-			pr_info("%s Found fd %d paddr %pK\n",
-				__func__, fd, paddr);
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return status;
-		}
-	}
-	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+	pr_debug("%s, fd %d\n", __func__, fd);
+	/* Called for every packet carrying a buffer, stay off the mutex */
+	rcu_read_lock();
+	msm_audio_fd_data = msm_audio_find_fd_data(fd);
+	if (msm_audio_fd_data) {
+		*paddr = msm_audio_fd_data->paddr;
+		*pa_len = msm_audio_fd_data->plen;
+		status = 0;
+		pr_debug("%s Found fd %d paddr %pK\n",
+			__func__, fd, paddr);
+	}
+	rcu_read_unlock();
 	return status;
 }
 EXPORT_SYMBOL(msm_audio_get_phy_addr);
@@ -442,15 +469,11 @@ static int msm_audio_set_hyp_assign(int fd, bool assign)
 	pr_debug("%s, fd %d\n", __func__, fd);
 
 	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			status = 0;
-			pr_debug("%s Found fd %d\n", __func__, fd);
-			msm_audio_fd_data->hyp_assign = assign;
-			mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
-			return status;
-		}
+	msm_audio_fd_data = msm_audio_find_fd_data(fd);
+	if (msm_audio_fd_data) {
+		status = 0;
+		pr_debug("%s Found fd %d\n", __func__, fd);
+		msm_audio_fd_data->hyp_assign = assign;
 	}
 	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
 	return status;
@@ -460,17 +483,14 @@ void msm_audio_get_handle(int fd, void **handle)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
 
-	pr_info("%s fd %d\n", __func__, fd);
-	mutex_lock(&(msm_audio_ion_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_ion_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*handle = (struct dma_buf *)msm_audio_fd_data->handle;
-			pr_info("%s handle %pK\n", __func__, *handle);
-			break;
-		}
+	pr_debug("%s fd %d\n", __func__, fd);
+	rcu_read_lock();
+	msm_audio_fd_data = msm_audio_find_fd_data(fd);
+	if (msm_audio_fd_data) {
+		*handle = (struct dma_buf *)msm_audio_fd_data->handle;
+		pr_debug("%s handle %pK\n", __func__, *handle);
 	}
-	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
+	rcu_read_unlock();
 }
 
 /**
@@ -625,10 +645,8 @@ void msm_audio_ion_crash_handler(void)
 		if(ptr) {
 			msm_audio_fd_data = list_entry(ptr, struct msm_audio_fd_data,
 							list);
-			if(msm_audio_fd_data) {
-				list_del(&(msm_audio_fd_data->list));
-				kfree(msm_audio_fd_data);
-			}
+			if(msm_audio_fd_data)
+				msm_audio_del_fd_data(msm_audio_fd_data);
 		}
 	}
 	mutex_unlock(&(msm_audio_ion_fd_list.list_mutex));
@@ -913,10 +931,12 @@ static int msm_audio_ion_probe(struct platform_device *pdev)
 	dev_set_drvdata(dev, msm_audio_ion_data);
 	if (!msm_audio_ion_fd_list_init) {
 		INIT_LIST_HEAD(&msm_audio_ion_fd_list.fd_list);
+		hash_init(msm_audio_ion_fd_list.fd_hash);
+		hash_init(msm_audio_ion_fd_list.handle_hash);
 		mutex_init(&(msm_audio_ion_fd_list.list_mutex));
 		msm_audio_ion_fd_list_init = true;
 	}
-	INIT_LIST_HEAD(&msm_audio_ion_data->alloc_list);
+	hash_init(msm_audio_ion_data->alloc_hash);
 	mutex_init(&(msm_audio_ion_data->list_mutex));
 	rc = msm_audio_ion_reg_chrdev(msm_audio_ion_data);
 	if (rc) {
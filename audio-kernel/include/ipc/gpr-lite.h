@@ -233,6 +233,11 @@ struct gpr_pkt {
 
 #define GPR_IBASIC_RSP_RESULT 0x02001005
 
+/* Bits 24 to 31 of an opcode -- 0x01 command, 0x02 response, 0x03 event */
+#define GPR_OPCODE_TYPE(op)		(((op) >> 24) & 0xFF)
+#define GPR_OPCODE_TYPE_RSP		0x02
+#define GPR_OPCODE_IS_RSP(op)		(GPR_OPCODE_TYPE(op) == GPR_OPCODE_TYPE_RSP)
+
 /* Bits 0 to 15 -- Minor version,  Bits 16 to 31 -- Major version */
 #define GPR_SVC_MAJOR_VERSION(v)	((v >> 16) & 0xFF)
 #define GPR_SVC_MINOR_VERSION(v)	(v & 0xFF)
@@ -281,7 +286,24 @@ void gpr_driver_unregister(struct gpr_driver *drv);
 	module_driver(__gpr_driver, gpr_driver_register, \
 			gpr_driver_unregister)
 
+/**
+ * gpr_async_cb_t - Completion callback for gpr_send_pkt_async()
+ *
+ * @adev: gpr device the command was submitted on
+ * @rsp: Response packet whose token and ports match the command,
+ *       NULL if the command failed before a response arrived
+ * @status: 0 when @rsp is valid, negative error code otherwise
+ * @priv: Client private data passed at submission
+ *
+ * Called from the rpmsg receive context, must not sleep.
+ */
+typedef void (*gpr_async_cb_t)(struct gpr_device *adev, struct gpr_pkt *rsp,
+			       int status, void *priv);
+
 int gpr_send_pkt(struct gpr_device *adev, struct gpr_pkt *pkt);
+int gpr_send_pkt_async(struct gpr_device *adev, struct gpr_pkt *pkt,
+		       gpr_async_cb_t cb, void *priv);
+int gpr_cancel_pkt_async(struct gpr_device *adev, uint32_t token, void *priv);
 
 enum gpr_subsys_state gpr_get_modem_state(void);
 enum gpr_subsys_state gpr_get_q6_state(void);
@@ -0,0 +1,78 @@
+#ifndef _UAPI_AUDIO_PKT_H
+#define _UAPI_AUDIO_PKT_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * audio_pkt_msg:
+ *	One GPR message in a batch.
+ *
+ * @buf:
+ *	User address of the message buffer.
+ * @len:
+ *	Write: size of the GPR packet in @buf.
+ *	Read: size of @buf on input, size of the received packet on output.
+ *	If the packet does not fit, the read fails with EMSGSIZE, the
+ *	packet stays queued and @len is set to the size it needs.
+ */
+struct audio_pkt_msg {
+	__u64 buf;
+	__u32 len;
+	__u32 reserved;
+};
+
+/*
+ * audio_pkt_msg_batch:
+ *	Argument of AUDIO_PKT_IOCTL_WRITE_MSGS and AUDIO_PKT_IOCTL_READ_MSGS.
+ *
+ * @msgs:
+ *	User address of an array of struct audio_pkt_msg.
+ * @num_msgs:
+ *	Number of entries in @msgs, at most AUDIO_PKT_MAX_BATCH.
+ * @num_done:
+ *	Number of entries sent or filled in on return. Processing stops at
+ *	the first failing entry, reads return what is queued without
+ *	waiting once one message has been copied.
+ */
+struct audio_pkt_msg_batch {
+	__u64 msgs;
+	__u32 num_msgs;
+	__u32 num_done;
+};
+
+#define AUDIO_PKT_MAX_BATCH		64
+
+/*
+ * Shared response ring, enabled by mmap() of the device at offset 0 with a
+ * length of AUDIO_PKT_RING_MMAP_SIZE. Once mapped, responses and events are
+ * placed in the ring instead of the read() queue. If the ring fills up,
+ * messages overflow to the read() queue until it is drained again, so
+ * clients drain the ring first and then read().
+ *
+ * Records are a __u32 length followed by the packet, padded to 4 bytes and
+ * wrapping at the end of the data area. @head and @tail are free running
+ * byte counters, the kernel only writes @head and the client only @tail.
+ * poll() reports POLLIN while the ring or the read() queue is non-empty,
+ * sleepers are only woken on the empty to non-empty transition.
+ */
+struct audio_pkt_ring_hdr {
+	__u32 head;
+	__u32 tail;
+	__u32 data_size;
+	__u32 overflow_cnt;
+};
+
+#define AUDIO_PKT_RING_DATA_OFFSET	64
+#define AUDIO_PKT_RING_DATA_SIZE	(32 * 1024)
+#define AUDIO_PKT_RING_MMAP_SIZE	\
+	(AUDIO_PKT_RING_DATA_OFFSET + AUDIO_PKT_RING_DATA_SIZE)
+
+#define AUDIO_PKT_IOCTL_MAGIC		'P'
+
+#define AUDIO_PKT_IOCTL_WRITE_MSGS	\
+	_IOWR(AUDIO_PKT_IOCTL_MAGIC, 1, struct audio_pkt_msg_batch)
+#define AUDIO_PKT_IOCTL_READ_MSGS	\
+	_IOWR(AUDIO_PKT_IOCTL_MAGIC, 2, struct audio_pkt_msg_batch)
+
+#endif
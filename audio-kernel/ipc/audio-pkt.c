@@ -27,6 +27,9 @@
 #include <linux/fs.h>
 #include <linux/uaccess.h>
 #include <linux/termios.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <audio/linux/audio_pkt.h>
 #include <ipc/gpr-lite.h>
 #include <dsp/spf-core.h>
 #include <dsp/msm_audio_ion.h>
@@ -84,6 +87,8 @@ enum audio_pkt_state {
  * @ch_name:	audio channel to match to
  * @audio_pkt_major: Major number of audio pkt driver
  * @audio_pkt_class: audio pkt class pointer
+ * @ring:	optional response ring shared with the client, under @queue_lock
+ * @ring_lock:	serializes ring setup and teardown
  */
 struct audio_pkt_device {
 	struct device *dev;
@@ -99,6 +104,9 @@ struct audio_pkt_device {
 
 	dev_t audio_pkt_major;
 	struct class *audio_pkt_class;
+
+	struct audio_pkt_ring_hdr *ring;
+	struct mutex ring_lock;
 };
 
 struct audio_pkt_priv {
@@ -174,6 +182,7 @@ int audio_pkt_release(struct inode *inode, struct file *file)
 	struct audio_pkt_priv *ap_priv = file->private_data;
 	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
 
+	struct audio_pkt_ring_hdr *ring;
 	struct sk_buff *skb;
 	unsigned long flags;
 
@@ -183,6 +192,7 @@ int audio_pkt_release(struct inode *inode, struct file *file)
 	}
 
 	AUDIO_PKT_INFO("%s: for %s \n", __func__,audpkt_dev->ch_name);
+	mutex_lock(&audpkt_dev->ring_lock);
 	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
 
 	/* Discard all SKBs */
@@ -190,8 +200,12 @@ int audio_pkt_release(struct inode *inode, struct file *file)
 		skb = skb_dequeue(&audpkt_dev->queue);
 		kfree_skb(skb);
 	}
+	ring = audpkt_dev->ring;
+	audpkt_dev->ring = NULL;
 	wake_up_interruptible(&audpkt_dev->readq);
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+	mutex_unlock(&audpkt_dev->ring_lock);
+	vfree(ring);
 
 	file->private_data = NULL;
 	spf_core_apm_close_all();
@@ -227,33 +241,8 @@ static int audio_pkt_internal_release(struct platform_device *adev)
 	return 0;
 }
 
-/**
- * audio_pkt_read() - read() syscall for the audio_pkt device
- * file:	Pointer to the file structure.
- * buf:		Pointer to the userspace buffer.
- * count:	Number bytes to read from the file.
- * ppos:	Pointer to the position into the file.
- *
- * This function is used to Read the data from audio pkt device when
- * userspace client do a read() system call. All input arguments are
- * validated by the virtual file system before calling this function.
- */
-ssize_t audio_pkt_read(struct file *file, char __user *buf,
-		       size_t count, loff_t *ppos)
+static int audio_pkt_check_state(struct audio_pkt_priv *ap_priv)
 {
-	struct audio_pkt_priv *ap_priv = file->private_data;
-	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
-
-	unsigned long flags;
-	struct sk_buff *skb;
-	int use;
-	uint32_t *temp;
-
-	if (!audpkt_dev) {
-		AUDIO_PKT_ERR("invalid device handle\n");
-		return -EINVAL;
-	}
-
 	mutex_lock(&ap_priv->lock);
 	if (AUDIO_PKT_PROBED != ap_priv->status)
 	{
@@ -263,18 +252,37 @@ ssize_t audio_pkt_read(struct file *file, char __user *buf,
 	}
 	mutex_unlock(&ap_priv->lock);
 
+	return 0;
+}
+
+/*
+ * Take the oldest message off the read() queue, waiting for one if @block
+ * is set and the queue is empty.
+ */
+static struct sk_buff *audio_pkt_dequeue(struct audio_pkt_priv *ap_priv,
+					 bool block)
+{
+	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+	unsigned long flags;
+	struct sk_buff *skb;
+	int ret;
+
+	ret = audio_pkt_check_state(ap_priv);
+	if (ret)
+		return ERR_PTR(ret);
+
 	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
 	/* Wait for data in the queue */
 	if (skb_queue_empty(&audpkt_dev->queue)) {
 		spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 
-		if (file->f_flags & O_NONBLOCK)
-			return -EAGAIN;
+		if (!block)
+			return ERR_PTR(-EAGAIN);
 
 		/* Wait until we get data or the endpoint goes away */
 		if (wait_event_interruptible(audpkt_dev->readq,
 					!skb_queue_empty(&audpkt_dev->queue)))
-			return -ERESTARTSYS;
+			return ERR_PTR(-ERESTARTSYS);
 
 		spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
 	}
@@ -282,12 +290,55 @@ ssize_t audio_pkt_read(struct file *file, char __user *buf,
 	skb = skb_dequeue(&audpkt_dev->queue);
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 	if (!skb)
-		return -EFAULT;
+		return ERR_PTR(-EFAULT);
+
+	return skb;
+}
+
+/* Put a dequeued message back so the next read returns it first */
+static void audio_pkt_requeue(struct audio_pkt_priv *ap_priv,
+			      struct sk_buff *skb)
+{
+	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+	skb_queue_head(&audpkt_dev->queue, skb);
+	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+}
+
+/**
+ * audio_pkt_read() - read() syscall for the audio_pkt device
+ * file:	Pointer to the file structure.
+ * buf:		Pointer to the userspace buffer.
+ * count:	Number bytes to read from the file.
+ * ppos:	Pointer to the position into the file.
+ *
+ * This function is used to Read the data from audio pkt device when
+ * userspace client do a read() system call. All input arguments are
+ * validated by the virtual file system before calling this function.
+ */
+ssize_t audio_pkt_read(struct file *file, char __user *buf,
+		       size_t count, loff_t *ppos)
+{
+	struct audio_pkt_priv *ap_priv = file->private_data;
+	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+
+	struct sk_buff *skb;
+	int use;
+
+	if (!audpkt_dev) {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	skb = audio_pkt_dequeue(ap_priv, !(file->f_flags & O_NONBLOCK));
+	if (IS_ERR(skb))
+		return PTR_ERR(skb);
 
 	use = min_t(size_t, count, skb->len);
 	if (copy_to_user(buf, skb->data, use))
 		use = -EFAULT;
-	temp = (uint32_t *) skb->data;
 	kfree_skb(skb);
 
 	return use;
@@ -321,6 +372,44 @@ int audpkt_chk_and_update_physical_addr(struct audio_gpr_pkt *gpr_pkt)
 	return ret;
 }
 
+/*
+ * Validate one user supplied GPR packet and hand it to GPR. Called with
+ * the device lock held, @kbuf holds @count bytes copied from userspace.
+ */
+static int __audio_pkt_send(struct audio_pkt_priv *ap_priv, void *kbuf,
+			    size_t count)
+{
+	struct gpr_hdr *audpkt_hdr = (struct gpr_hdr *) kbuf;
+	int ret;
+
+	/* validate packet size */
+	if ((count > MAX_PACKET_SIZE) ||
+	    (count < sizeof(struct gpr_pkt)) ||
+	    (count < GPR_PKT_GET_PACKET_BYTE_SIZE(audpkt_hdr->header))) {
+		AUDIO_PKT_ERR("Invalid count %zu\n",count);
+		return -EINVAL;
+	}
+
+	if (audpkt_hdr->opcode == APM_CMD_SHARED_MEM_MAP_REGIONS) {
+		if (count < sizeof(struct audio_gpr_pkt )) {
+			AUDIO_PKT_ERR("Invalid count %zu\n",count);
+			return -EINVAL;
+		}
+		ret = audpkt_chk_and_update_physical_addr((struct audio_gpr_pkt *) audpkt_hdr);
+		if (ret < 0) {
+			AUDIO_PKT_ERR("Update Physical Address Failed -%d\n", ret);
+			return ret;
+		}
+	}
+
+	ret = gpr_send_pkt(ap_priv->adev,(struct gpr_pkt *) kbuf);
+	if (ret < 0) {
+		AUDIO_PKT_ERR("APR Send Packet Failed ret -%d\n", ret);
+	}
+
+	return ret;
+}
+
 /**
  * audio_pkt_write() - write() syscall for the audio_pkt device
  * file:	Pointer to the file structure.
@@ -337,7 +426,6 @@ ssize_t audio_pkt_write(struct file *file, const char __user *buf,
 {
 	struct audio_pkt_priv *ap_priv = file->private_data;
 	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
-	struct gpr_hdr *audpkt_hdr = NULL;
 	void *kbuf;
 	int ret;
 
@@ -346,14 +434,10 @@ ssize_t audio_pkt_write(struct file *file, const char __user *buf,
 		return -EINVAL;
 	}
 
-	mutex_lock(&ap_priv->lock);
-	if (AUDIO_PKT_PROBED != ap_priv->status)
-	{
-		mutex_unlock(&ap_priv->lock);
-		AUDIO_PKT_ERR("dev is in reset\n");
-		return -ENETRESET;
-	}
-	mutex_unlock(&ap_priv->lock);
+	ret = audio_pkt_check_state(ap_priv);
+	if (ret)
+		return ret;
+
 	if (count < sizeof(struct gpr_hdr)) {
 		AUDIO_PKT_ERR("Invalid count %zu\n",count);
 		return  -EINVAL;
@@ -363,47 +447,275 @@ ssize_t audio_pkt_write(struct file *file, const char __user *buf,
 	if (IS_ERR(kbuf))
 		return PTR_ERR(kbuf);
 
-	audpkt_hdr = (struct gpr_hdr *) kbuf;
-
-	/* validate packet size */
-	if ((count > MAX_PACKET_SIZE) || (count < GPR_PKT_GET_PACKET_BYTE_SIZE(audpkt_hdr->header)))
-	{
-		ret = -EINVAL;
+	if (mutex_lock_interruptible(&audpkt_dev->lock)) {
+		ret = -ERESTARTSYS;
 		goto free_kbuf;
 	}
+	ret = __audio_pkt_send(ap_priv, kbuf, count);
+	mutex_unlock(&audpkt_dev->lock);
 
-	if (audpkt_hdr->opcode == APM_CMD_SHARED_MEM_MAP_REGIONS) {
-		if (count < sizeof(struct audio_gpr_pkt )) {
-			AUDIO_PKT_ERR("Invalid count %zu\n",count);
-			ret = -EINVAL;
-			goto free_kbuf;
-		}
-		ret = audpkt_chk_and_update_physical_addr((struct audio_gpr_pkt *) audpkt_hdr);
-		if (ret < 0) {
-			AUDIO_PKT_ERR("Update Physical Address Failed -%d\n", ret);
-			goto free_kbuf;
-		}
-	}
+free_kbuf:
+	kfree(kbuf);
+	return ret < 0 ? ret : count;
+}
+
+/*
+ * Send every message of the batch with a single bounce buffer and a single
+ * acquisition of the device lock, stopping at the first failure.
+ */
+static long audio_pkt_write_msgs(struct audio_pkt_priv *ap_priv,
+				 struct audio_pkt_msg *msgs, uint32_t num_msgs,
+				 uint32_t *num_done)
+{
+	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+	void *kbuf;
+	uint32_t i;
+	int ret = 0;
+
+	*num_done = 0;
+	ret = audio_pkt_check_state(ap_priv);
+	if (ret)
+		return ret;
+
+	kbuf = kmalloc(MAX_PACKET_SIZE, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
 
 	if (mutex_lock_interruptible(&audpkt_dev->lock)) {
 		ret = -ERESTARTSYS;
 		goto free_kbuf;
 	}
-	if (count < sizeof(struct gpr_pkt )) {
-		AUDIO_PKT_ERR("Invalid count %zu\n",count);
-		ret = -EINVAL;
-		mutex_unlock(&audpkt_dev->lock);
-		goto free_kbuf;
-	}
-	ret = gpr_send_pkt(ap_priv->adev,(struct gpr_pkt *) kbuf);
-	if (ret < 0) {
-		AUDIO_PKT_ERR("APR Send Packet Failed ret -%d\n", ret);
+	for (i = 0; i < num_msgs; i++) {
+		if (msgs[i].len < sizeof(struct gpr_hdr) ||
+		    msgs[i].len > MAX_PACKET_SIZE) {
+			AUDIO_PKT_ERR("Invalid len %u for msg %u\n",
+				msgs[i].len, i);
+			ret = -EINVAL;
+			break;
+		}
+		if (copy_from_user(kbuf, u64_to_user_ptr(msgs[i].buf),
+				   msgs[i].len)) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = __audio_pkt_send(ap_priv, kbuf, msgs[i].len);
+		if (ret < 0)
+			break;
+		*num_done = i + 1;
 	}
 	mutex_unlock(&audpkt_dev->lock);
 
 free_kbuf:
 	kfree(kbuf);
-	return ret < 0 ? ret : count;
+	/* Partial batches report progress through num_done */
+	return *num_done ? 0 : ret;
+}
+
+/*
+ * Fill the batch from the read() queue. Only the first message may wait,
+ * the rest of the batch takes whatever is already queued. A message that
+ * does not fit its buffer is left at the head of the queue and the size
+ * it needs is returned in that entry's len.
+ */
+static long audio_pkt_read_msgs(struct audio_pkt_priv *ap_priv, bool block,
+				struct audio_pkt_msg *msgs, uint32_t num_msgs,
+				uint32_t *num_done)
+{
+	struct sk_buff *skb;
+	uint32_t i;
+	int ret = 0;
+
+	*num_done = 0;
+	for (i = 0; i < num_msgs; i++) {
+		skb = audio_pkt_dequeue(ap_priv, block && !i);
+		if (IS_ERR(skb)) {
+			ret = PTR_ERR(skb);
+			break;
+		}
+
+		if (skb->len > msgs[i].len) {
+			AUDIO_PKT_ERR("msg %u buffer too small %u < %u\n",
+				i, msgs[i].len, skb->len);
+			msgs[i].len = skb->len;
+			audio_pkt_requeue(ap_priv, skb);
+			ret = -EMSGSIZE;
+			break;
+		} else if (copy_to_user(u64_to_user_ptr(msgs[i].buf),
+					skb->data, skb->len)) {
+			ret = -EFAULT;
+		} else {
+			msgs[i].len = skb->len;
+		}
+		kfree_skb(skb);
+		if (ret)
+			break;
+		*num_done = i + 1;
+	}
+
+	if (*num_done && ret == -EAGAIN)
+		ret = 0;
+
+	return ret;
+}
+
+/**
+ * audio_pkt_ioctl() - ioctl() syscall for the audio_pkt device
+ * file:	Pointer to the file structure.
+ * cmd:		Batched read or write command.
+ * arg:		Pointer to struct audio_pkt_msg_batch.
+ *
+ * Moves up to AUDIO_PKT_MAX_BATCH messages in one system call. The number
+ * of messages processed is returned in num_done even on failure.
+ */
+static long audio_pkt_ioctl(struct file *file, unsigned int cmd,
+			    unsigned long arg)
+{
+	struct audio_pkt_priv *ap_priv = file->private_data;
+	struct audio_pkt_msg_batch batch;
+	struct audio_pkt_msg *msgs;
+	void __user *argp = (void __user *)arg;
+	uint32_t num_len;
+	long ret;
+
+	if (!ap_priv || !ap_priv->ap_dev) {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	if (cmd != AUDIO_PKT_IOCTL_WRITE_MSGS &&
+	    cmd != AUDIO_PKT_IOCTL_READ_MSGS)
+		return -ENOTTY;
+
+	if (copy_from_user(&batch, argp, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.num_msgs || batch.num_msgs > AUDIO_PKT_MAX_BATCH) {
+		AUDIO_PKT_ERR("Invalid num_msgs %u\n", batch.num_msgs);
+		return -EINVAL;
+	}
+
+	msgs = memdup_user(u64_to_user_ptr(batch.msgs),
+			   batch.num_msgs * sizeof(*msgs));
+	if (IS_ERR(msgs))
+		return PTR_ERR(msgs);
+
+	if (cmd == AUDIO_PKT_IOCTL_WRITE_MSGS) {
+		ret = audio_pkt_write_msgs(ap_priv, msgs, batch.num_msgs,
+					   &batch.num_done);
+	} else {
+		ret = audio_pkt_read_msgs(ap_priv,
+					  !(file->f_flags & O_NONBLOCK),
+					  msgs, batch.num_msgs,
+					  &batch.num_done);
+		/* Report received lengths, and the one needed on -EMSGSIZE */
+		num_len = batch.num_done + (ret == -EMSGSIZE);
+		if (num_len &&
+		    copy_to_user(u64_to_user_ptr(batch.msgs), msgs,
+				 num_len * sizeof(*msgs)))
+			ret = -EFAULT;
+	}
+	kfree(msgs);
+
+	if (copy_to_user(argp, &batch, sizeof(batch)))
+		return -EFAULT;
+
+	return ret;
+}
+
+/**
+ * audio_pkt_mmap() - mmap() syscall for the audio_pkt device
+ * file:	Pointer to the file structure.
+ * vma:		Mapping of AUDIO_PKT_RING_MMAP_SIZE bytes at offset 0.
+ *
+ * Maps the response ring into the client. Incoming messages are placed
+ * in the ring from then on instead of the read() queue.
+ */
+static int audio_pkt_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct audio_pkt_priv *ap_priv = file->private_data;
+	struct audio_pkt_device *audpkt_dev = ap_priv->ap_dev;
+	struct audio_pkt_ring_hdr *ring;
+	unsigned long flags;
+	int ret;
+
+	if (!audpkt_dev) {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start >
+			PAGE_ALIGN(AUDIO_PKT_RING_MMAP_SIZE))
+		return -EINVAL;
+
+	mutex_lock(&audpkt_dev->ring_lock);
+	ring = audpkt_dev->ring;
+	if (!ring) {
+		ring = vmalloc_user(AUDIO_PKT_RING_MMAP_SIZE);
+		if (!ring) {
+			ret = -ENOMEM;
+			goto done;
+		}
+		ring->data_size = AUDIO_PKT_RING_DATA_SIZE;
+	}
+
+	ret = remap_vmalloc_range(vma, ring, 0);
+	if (ret) {
+		AUDIO_PKT_ERR("ring mmap failed %d\n", ret);
+		if (!audpkt_dev->ring)
+			vfree(ring);
+		goto done;
+	}
+
+	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+	audpkt_dev->ring = ring;
+	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+done:
+	mutex_unlock(&audpkt_dev->ring_lock);
+	return ret;
+}
+
+/*
+ * Copy @len bytes into the ring data area at free running offset @pos,
+ * wrapping at the end of the data area.
+ */
+static void audio_pkt_ring_copy(struct audio_pkt_ring_hdr *ring, uint32_t pos,
+				const void *src, uint32_t len)
+{
+	uint8_t *data = (uint8_t *)ring + AUDIO_PKT_RING_DATA_OFFSET;
+	uint32_t off = pos & (AUDIO_PKT_RING_DATA_SIZE - 1);
+	uint32_t first = min_t(uint32_t, len, AUDIO_PKT_RING_DATA_SIZE - off);
+
+	memcpy(data + off, src, first);
+	if (len > first)
+		memcpy(data, (const uint8_t *)src + first, len - first);
+}
+
+/*
+ * Append a record to the shared ring. Returns false if the ring is full,
+ * the caller then queues the message for read(). Called with queue_lock
+ * held, @was_empty tells whether the client may be waiting on an empty ring.
+ */
+static bool audio_pkt_ring_put(struct audio_pkt_ring_hdr *ring,
+			       const void *data, uint32_t len, bool *was_empty)
+{
+	uint32_t head = ring->head;
+	uint32_t tail = smp_load_acquire(&ring->tail);
+	uint32_t rec_len = sizeof(uint32_t) + ALIGN(len, sizeof(uint32_t));
+
+	if (head - tail > AUDIO_PKT_RING_DATA_SIZE ||
+	    AUDIO_PKT_RING_DATA_SIZE - (head - tail) < rec_len) {
+		ring->overflow_cnt++;
+		return false;
+	}
+
+	*was_empty = (head == tail);
+	audio_pkt_ring_copy(ring, head, &len, sizeof(len));
+	audio_pkt_ring_copy(ring, head + sizeof(len), data, len);
+	/* Publish the record only after its payload */
+	smp_store_release(&ring->head, head + rec_len);
+
+	return true;
 }
 
 /**
@@ -430,7 +742,9 @@ static unsigned int audio_pkt_poll(struct file *file, poll_table *wait)
 	mutex_lock(&audpkt_dev->lock);
 
 	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
-	if (!skb_queue_empty(&audpkt_dev->queue))
+	if (!skb_queue_empty(&audpkt_dev->queue) ||
+	    (audpkt_dev->ring && audpkt_dev->ring->head !=
+				 READ_ONCE(audpkt_dev->ring->tail)))
 		mask |= POLLIN | POLLRDNORM;
 
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
@@ -446,6 +760,9 @@ static const struct file_operations audio_pkt_fops = {
 	.read = audio_pkt_read,
 	.write = audio_pkt_write,
 	.poll = audio_pkt_poll,
+	.unlocked_ioctl = audio_pkt_ioctl,
+	.compat_ioctl = audio_pkt_ioctl,
+	.mmap = audio_pkt_mmap,
 };
 
 /**
@@ -465,12 +782,23 @@ static int audio_pkt_srvc_callback(struct gpr_device *adev,
 	struct sk_buff *skb;
 	struct gpr_hdr *hdr = (struct gpr_hdr *)data;
 	uint16_t hdr_size, pkt_size;
+	bool was_empty = false;
+
 	hdr_size = GPR_PKT_GET_HEADER_BYTE_SIZE(hdr->header);
 	pkt_size = GPR_PKT_GET_PACKET_BYTE_SIZE(hdr->header);
 
     AUDIO_PKT_INFO("%s: header %d packet %d \n",
 		__func__,hdr_size, pkt_size);
 
+	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+	/* Keep ordering, nothing goes to the ring while read() has a backlog */
+	if (audpkt_dev->ring && skb_queue_empty(&audpkt_dev->queue) &&
+	    audio_pkt_ring_put(audpkt_dev->ring, data, pkt_size, &was_empty)) {
+		spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+		goto wake;
+	}
+	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
+
 	skb = alloc_skb(pkt_size, GFP_ATOMIC);
 	if (!skb)
 		return -ENOMEM;
@@ -478,11 +806,17 @@ static int audio_pkt_srvc_callback(struct gpr_device *adev,
 	skb_put_data(skb, data, pkt_size);
 
 	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
+	was_empty = skb_queue_empty(&audpkt_dev->queue);
 	skb_queue_tail(&audpkt_dev->queue, skb);
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 
-	/* wake up any blocking processes, waiting for new data */
-	wake_up_interruptible(&audpkt_dev->readq);
+wake:
+	/*
+	 * Readers only sleep on an empty queue, so wake them up on the
+	 * empty to non-empty transition only.
+	 */
+	if (was_empty)
+		wake_up_interruptible(&audpkt_dev->readq);
 	return 0;
 }
 
@@ -642,6 +976,7 @@ static int audio_pkt_platform_driver_probe(struct platform_device *pdev)
 	dev_set_name(audpkt_dev->dev, audpkt_dev->dev_name);
 
 	mutex_init(&audpkt_dev->lock);
+	mutex_init(&audpkt_dev->ring_lock);
 
 	spin_lock_init(&audpkt_dev->queue_lock);
 	skb_queue_head_init(&audpkt_dev->queue);
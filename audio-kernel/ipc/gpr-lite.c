@@ -21,6 +21,8 @@
 #include <ipc/gpr-lite.h>
 #include <linux/rpmsg.h>
 #include <linux/of.h>
+#include <linux/hashtable.h>
+#include <linux/workqueue.h>
 
 #include <soc/snd_event.h>
 #include <dsp/audio_notifier.h>
@@ -28,6 +30,37 @@
 #define APM_EVENT_MODULE_TO_CLIENT	0x03001000
 #define WAKELOCK_TIMEOUT 200
 
+#define GPR_TX_QUEUE_SIZE	64
+#define GPR_TX_PENDING_BITS	5
+#define GPR_TX_RETRY_DELAY_US	500
+
+/*
+ * struct gpr_tx_desc - Async submission descriptor
+ *
+ * @adev: gpr device the packet was submitted on
+ * @pkt: Private copy of the packet, freed once handed to rpmsg
+ * @pkt_size: Packet size in bytes
+ * @src_port: Source port of the command, matched against rsp dst_port
+ * @dst_port: Destination port of the command, matched against rsp src_port
+ * @token: Command token, key of the pending table
+ * @cb: Completion callback, NULL for fire and forget packets
+ * @priv: Client private data for @cb
+ * @list: Entry in the free list or in the tx queue
+ * @hnode: Entry in the pending table while waiting for a response
+ */
+struct gpr_tx_desc {
+	struct gpr_device *adev;
+	struct gpr_pkt *pkt;
+	uint32_t pkt_size;
+	uint32_t src_port;
+	uint32_t dst_port;
+	uint32_t token;
+	gpr_async_cb_t cb;
+	void *priv;
+	struct list_head list;
+	struct hlist_node hnode;
+};
+
 struct gpr {
 	struct rpmsg_endpoint *ch;
 	struct device *dev;
@@ -39,6 +72,13 @@ struct gpr {
 	int dest_domain_id;
 	struct work_struct notifier_reg_work;
 	struct wakeup_source *wsource;
+
+	spinlock_t tx_lock;
+	struct gpr_tx_desc *tx_pool;
+	struct list_head tx_free;
+	struct list_head tx_queue;
+	DECLARE_HASHTABLE(tx_pending, GPR_TX_PENDING_BITS);
+	struct delayed_work tx_work;
 };
 
 static struct gpr_q6 q6;
@@ -142,6 +182,308 @@ int gpr_send_pkt(struct gpr_device *adev, struct gpr_pkt *pkt)
 }
 EXPORT_SYMBOL_GPL(gpr_send_pkt);
 
+static void gpr_tx_desc_put(struct gpr *gpr, struct gpr_tx_desc *desc)
+{
+	unsigned long flags;
+
+	kfree(desc->pkt);
+	desc->pkt = NULL;
+	desc->cb = NULL;
+	desc->priv = NULL;
+	spin_lock_irqsave(&gpr->tx_lock, flags);
+	list_add(&desc->list, &gpr->tx_free);
+	spin_unlock_irqrestore(&gpr->tx_lock, flags);
+}
+
+static void gpr_tx_complete_list(struct gpr *gpr, struct list_head *done,
+				 int status)
+{
+	struct gpr_tx_desc *desc, *tmp;
+
+	list_for_each_entry_safe(desc, tmp, done, list) {
+		list_del_init(&desc->list);
+		if (desc->cb)
+			desc->cb(desc->adev, NULL, status, desc->priv);
+		gpr_tx_desc_put(gpr, desc);
+	}
+}
+
+/*
+ * Hand queued packets to rpmsg in submission order, stopping at the first
+ * one the transport has no room for. Packets that failed with anything
+ * other than back-pressure are moved to @failed. Called with tx_lock held.
+ */
+static void __gpr_tx_drain(struct gpr *gpr, struct list_head *failed)
+{
+	struct gpr_tx_desc *desc;
+	int ret;
+
+	while (!list_empty(&gpr->tx_queue)) {
+		desc = list_first_entry(&gpr->tx_queue,
+					struct gpr_tx_desc, list);
+		ret = rpmsg_trysend(gpr->ch, desc->pkt, desc->pkt_size);
+		if (ret == -EAGAIN || ret == -EBUSY) {
+			schedule_delayed_work(&gpr->tx_work,
+				usecs_to_jiffies(GPR_TX_RETRY_DELAY_US));
+			break;
+		}
+
+		list_del_init(&desc->list);
+		if (ret) {
+			dev_err_ratelimited(gpr->dev,
+				"%s: token 0x%x send failed %d\n",
+				__func__, desc->token, ret);
+			if (desc->cb)
+				hash_del(&desc->hnode);
+			list_add_tail(&desc->list, failed);
+			continue;
+		}
+
+		kfree(desc->pkt);
+		desc->pkt = NULL;
+		/* Descriptors with a callback live on until the response */
+		if (!desc->cb)
+			list_add(&desc->list, &gpr->tx_free);
+	}
+}
+
+static void gpr_tx_work_fn(struct work_struct *work)
+{
+	struct gpr *gpr = container_of(to_delayed_work(work),
+				       struct gpr, tx_work);
+	unsigned long flags;
+	LIST_HEAD(failed);
+
+	spin_lock_irqsave(&gpr->tx_lock, flags);
+	__gpr_tx_drain(gpr, &failed);
+	spin_unlock_irqrestore(&gpr->tx_lock, flags);
+
+	gpr_tx_complete_list(gpr, &failed, -EIO);
+}
+
+/*
+ * Fail every queued and in flight async command with @status, used when
+ * the remote goes down and no responses can arrive anymore.
+ */
+static void gpr_tx_flush(struct gpr *gpr, int status)
+{
+	struct gpr_tx_desc *desc;
+	struct hlist_node *tmp;
+	unsigned long flags;
+	LIST_HEAD(done);
+	int bkt;
+
+	if (!gpr->tx_pool)
+		return;
+
+	cancel_delayed_work(&gpr->tx_work);
+
+	spin_lock_irqsave(&gpr->tx_lock, flags);
+	hash_for_each_safe(gpr->tx_pending, bkt, tmp, desc, hnode) {
+		hash_del(&desc->hnode);
+		/* Still queued descriptors are moved below */
+		if (list_empty(&desc->list))
+			list_add_tail(&desc->list, &done);
+	}
+	list_splice_tail_init(&gpr->tx_queue, &done);
+	spin_unlock_irqrestore(&gpr->tx_lock, flags);
+
+	gpr_tx_complete_list(gpr, &done, status);
+}
+
+/*
+ * Match an incoming packet against the in flight async commands. Returns
+ * true when the packet was consumed by an async completion callback.
+ */
+static bool gpr_tx_complete(struct gpr *gpr, struct gpr_hdr *hdr)
+{
+	struct gpr_tx_desc *desc;
+	unsigned long flags;
+	bool found = false;
+
+	/* Commands and events carrying a reused token are not completions */
+	if (!gpr->tx_pool || !GPR_OPCODE_IS_RSP(hdr->opcode))
+		return false;
+
+	spin_lock_irqsave(&gpr->tx_lock, flags);
+	if (hash_empty(gpr->tx_pending)) {
+		spin_unlock_irqrestore(&gpr->tx_lock, flags);
+		return false;
+	}
+	hash_for_each_possible(gpr->tx_pending, desc, hnode, hdr->token) {
+		if (desc->token == hdr->token &&
+		    desc->src_port == hdr->dst_port &&
+		    desc->dst_port == hdr->src_port &&
+		    list_empty(&desc->list)) {
+			hash_del(&desc->hnode);
+			found = true;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&gpr->tx_lock, flags);
+
+	if (!found)
+		return false;
+
+	desc->cb(desc->adev, (struct gpr_pkt *)hdr, 0, desc->priv);
+	gpr_tx_desc_put(gpr, desc);
+
+	return true;
+}
+
+/**
+ * gpr_send_pkt_async() - Queue a gpr message without waiting for the transport
+ *
+ * @adev: Pointer to previously registered gpr device.
+ * @pkt: Pointer to gpr packet to send, copied before returning
+ * @cb: Optional callback invoked with the response matching the token
+ *      and ports of @pkt, or with an error if the packet could not be sent
+ * @priv: Client private data passed to @cb
+ *
+ * The packet is sent right away when the transport has room, otherwise it
+ * stays queued and is retried from a worker so callers never spin on
+ * -EAGAIN. Packets from all clients leave in submission order. Responses
+ * consumed by @cb are not delivered to the service driver callback, only
+ * response opcodes are matched. A caller that gives up waiting releases
+ * the command with gpr_cancel_pkt_async().
+ *
+ * Return: 0 on success, -EBUSY if the submission queue is full or
+ * another negative error code.
+ */
+int gpr_send_pkt_async(struct gpr_device *adev, struct gpr_pkt *pkt,
+		       gpr_async_cb_t cb, void *priv)
+{
+	struct gpr *gpr;
+	struct gpr_tx_desc *desc;
+	struct gpr_pkt *copy;
+	unsigned long flags;
+	uint32_t pkt_size;
+	bool was_empty;
+	LIST_HEAD(failed);
+
+	if (!adev || !adev->dev.parent || !pkt) {
+		pr_err("%s: invalid params adev[%pK] pkt[%pK]\n",
+			__func__, adev, pkt);
+		return -EINVAL;
+	}
+
+	gpr = dev_get_drvdata(adev->dev.parent);
+	if (!gpr || !gpr->tx_pool) {
+		pr_err_ratelimited("%s: Failed to get gpr dev pointer : gpr[%pK]\n",
+			__func__, gpr);
+		return -EINVAL;
+	}
+
+	if ((adev->domain_id == GPR_DOMAIN_ADSP) &&
+	    (gpr_get_q6_state() != GPR_SUBSYS_LOADED)) {
+		dev_err_ratelimited(gpr->dev, "%s: domain_id[%d], Still Dsp is not Up\n",
+			__func__, adev->domain_id);
+		return -ENETRESET;
+	} else if ((adev->domain_id == GPR_DOMAIN_MODEM) &&
+		   (gpr_get_modem_state() == GPR_SUBSYS_DOWN)) {
+		dev_err_ratelimited(gpr->dev, "%s: domain_id[%d], Still Modem is not Up\n",
+			__func__, adev->domain_id);
+		return -ENETRESET;
+	}
+
+	pkt_size = GPR_PKT_GET_PACKET_BYTE_SIZE(pkt->hdr.header);
+	if (pkt_size < GPR_HDR_SIZE)
+		return -EINVAL;
+
+	copy = kmemdup(pkt, pkt_size, GFP_ATOMIC);
+	if (!copy)
+		return -ENOMEM;
+	copy->hdr.dst_domain_id = adev->domain_id;
+
+	spin_lock_irqsave(&gpr->tx_lock, flags);
+	desc = list_first_entry_or_null(&gpr->tx_free,
+					struct gpr_tx_desc, list);
+	if (!desc) {
+		spin_unlock_irqrestore(&gpr->tx_lock, flags);
+		kfree(copy);
+		dev_err_ratelimited(gpr->dev, "%s: submission queue full\n",
+			__func__);
+		return -EBUSY;
+	}
+	list_del(&desc->list);
+
+	desc->adev = adev;
+	desc->pkt = copy;
+	desc->pkt_size = pkt_size;
+	desc->src_port = copy->hdr.src_port;
+	desc->dst_port = copy->hdr.dst_port;
+	desc->token = copy->hdr.token;
+	desc->cb = cb;
+	desc->priv = priv;
+
+	/* Register before sending, the response can beat the return */
+	if (cb)
+		hash_add(gpr->tx_pending, &desc->hnode, desc->token);
+
+	was_empty = list_empty(&gpr->tx_queue);
+	list_add_tail(&desc->list, &gpr->tx_queue);
+	dev_dbg(gpr->dev, "SVC_ID %d %s packet size %d token 0x%x\n",
+		adev->svc_id, __func__, pkt_size, desc->token);
+
+	/* A non empty queue means the retry worker is already armed */
+	if (was_empty)
+		__gpr_tx_drain(gpr, &failed);
+	spin_unlock_irqrestore(&gpr->tx_lock, flags);
+
+	gpr_tx_complete_list(gpr, &failed, -EIO);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gpr_send_pkt_async);
+
+/**
+ * gpr_cancel_pkt_async() - Drop an async command the caller stopped waiting for
+ *
+ * @adev: gpr device the command was submitted on
+ * @token: Token of the command
+ * @priv: Client private data passed at submission
+ *
+ * Releases the descriptor of a command whose response never arrived, the
+ * callback is not invoked and a late response goes to the service driver.
+ *
+ * Return: 0 if the command was cancelled, -ENOENT if it was not pending,
+ * in which case its callback has run or is running.
+ */
+int gpr_cancel_pkt_async(struct gpr_device *adev, uint32_t token, void *priv)
+{
+	struct gpr *gpr;
+	struct gpr_tx_desc *desc;
+	unsigned long flags;
+	bool found = false;
+
+	if (!adev || !adev->dev.parent)
+		return -EINVAL;
+
+	gpr = dev_get_drvdata(adev->dev.parent);
+	if (!gpr || !gpr->tx_pool)
+		return -EINVAL;
+
+	spin_lock_irqsave(&gpr->tx_lock, flags);
+	hash_for_each_possible(gpr->tx_pending, desc, hnode, token) {
+		if (desc->token == token && desc->adev == adev &&
+		    desc->priv == priv) {
+			hash_del(&desc->hnode);
+			/* Not handed to rpmsg yet, take it off the tx queue */
+			list_del_init(&desc->list);
+			found = true;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&gpr->tx_lock, flags);
+
+	if (!found)
+		return -ENOENT;
+
+	gpr_tx_desc_put(gpr, desc);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gpr_cancel_pkt_async);
+
  /**
   * apr_set_modem_state - Update modem load status.
   *
@@ -158,6 +500,7 @@ EXPORT_SYMBOL(gpr_set_modem_state);
 static void gpr_modem_down(unsigned long opcode)
 {
 	gpr_set_modem_state(GPR_SUBSYS_DOWN);
+	gpr_tx_flush(gpr_priv, -ENETRESET);
 	//dispatch_event(opcode, APR_DEST_MODEM);
 }
 
@@ -193,6 +536,7 @@ static void gpr_adsp_down(unsigned long opcode)
 {
 	dev_info(gpr_priv->dev,"%s: Q6 is Down\n", __func__);
 	gpr_set_q6_state(GPR_SUBSYS_DOWN);
+	gpr_tx_flush(gpr_priv, -ENETRESET);
 	snd_event_notify(gpr_priv->dev, SND_EVENT_DOWN);
 }
 
@@ -310,6 +654,8 @@ static int gpr_callback(struct rpmsg_device *rpdev, void *buf,
 		dev_err(gpr->dev, "%s: Acquire wakelock in case of module event with timeout %d",
 			__func__, WAKELOCK_TIMEOUT);
 		pm_wakeup_ws_event(gpr_priv->wsource, WAKELOCK_TIMEOUT, true);
+	} else if (gpr_tx_complete(gpr, hdr)) {
+		return 0;
 	}
 	svc_id = hdr->dst_port;
 	spin_lock_irqsave(&gpr->svcs_lock, flags);
@@ -495,7 +841,7 @@ static void gpr_notifier_register(struct work_struct *work)
 static int gpr_probe(struct rpmsg_device *rpdev)
 {
 	struct device *dev = &rpdev->dev;
-	int ret;
+	int ret, i;
 
 	if (!audio_notifier_probe_status()) {
 		pr_err("%s: Audio notify probe not completed, defer audio gpr probe\n",
@@ -520,6 +866,18 @@ static int gpr_probe(struct rpmsg_device *rpdev)
 	spin_lock_init(&gpr_priv->svcs_lock);
 	idr_init(&gpr_priv->svcs_idr);
 
+	spin_lock_init(&gpr_priv->tx_lock);
+	INIT_LIST_HEAD(&gpr_priv->tx_free);
+	INIT_LIST_HEAD(&gpr_priv->tx_queue);
+	hash_init(gpr_priv->tx_pending);
+	INIT_DELAYED_WORK(&gpr_priv->tx_work, gpr_tx_work_fn);
+	gpr_priv->tx_pool = devm_kcalloc(dev, GPR_TX_QUEUE_SIZE,
+					 sizeof(*gpr_priv->tx_pool), GFP_KERNEL);
+	if (!gpr_priv->tx_pool)
+		return -ENOMEM;
+	for (i = 0; i < GPR_TX_QUEUE_SIZE; i++)
+		list_add_tail(&gpr_priv->tx_pool[i].list, &gpr_priv->tx_free);
+
 	ret = snd_event_client_register(&rpdev->dev, &gpr_ssr_ops, NULL);
 	if (ret) {
 		dev_err(dev,"%s: Registration with SND event fwk failed ret = %d\n",
@@ -564,6 +922,8 @@ static void gpr_remove(struct rpmsg_device *rpdev)
 {
 	struct device *dev = &rpdev->dev;
 
+	cancel_delayed_work_sync(&gpr_priv->tx_work);
+	gpr_tx_flush(gpr_priv, -ENODEV);
 	wakeup_source_unregister(gpr_priv->wsource);
 	snd_event_client_deregister(&rpdev->dev);
 	dev_info(dev, "%s: deregistering via subsys_notif_register for domain_id(%d)",
@@ -12,6 +12,27 @@
 #include <soc/soundwire.h>
 #include <soc/internal.h>
 
+/* Registers packed per swr_bulk_write() call, kept on the stack */
+#define REGMAP_SWR_BULK_CHUNK 32
+
+static int regmap_swr_bulk_write_seq(struct swr_device *swr, u16 reg_addr,
+				     const u8 *val, size_t count)
+{
+	u16 reg[REGMAP_SWR_BULK_CHUNK];
+	size_t i, done, chunk;
+	int ret = 0;
+
+	for (done = 0; done < count; done += chunk) {
+		chunk = min_t(size_t, count - done, REGMAP_SWR_BULK_CHUNK);
+		for (i = 0; i < chunk; i++)
+			reg[i] = reg_addr + done + i;
+		ret = swr_bulk_write(swr, swr->dev_num, reg, val + done,
+				     chunk);
+		if (ret)
+			break;
+	}
+	return ret;
+}
 
 static int regmap_swr_gather_write(void *context,
 				const void *reg, size_t reg_size,
@@ -42,6 +63,13 @@ static int regmap_swr_gather_write(void *context,
 	}
 	reg_addr = *(u16 *)reg;
 	val_bytes = map->format.val_bytes;
+	/* Consecutive byte registers go out as bulk FIFO batches */
+	if (val_bytes == 1 && val_len > 1) {
+		ret = regmap_swr_bulk_write_seq(swr, reg_addr, val, val_len);
+		if (ret != -EOPNOTSUPP)
+			return ret;
+		ret = 0;
+	}
 	/* val_len = val_bytes * val_count */
 	for (i = 0; i < (val_len / val_bytes); i++) {
 		value = (u8 *)val + (val_bytes * i);
@@ -65,10 +93,10 @@ static int regmap_swr_raw_multi_reg_write(void *context, const void *data,
 	size_t val_bytes;
 	size_t pad_bytes;
 	size_t num_regs;
-	int i = 0;
+	size_t i, n = 0;
 	int ret = 0;
-	u16 *reg;
-	u8 *val;
+	u16 reg[REGMAP_SWR_BULK_CHUNK];
+	u8 val[REGMAP_SWR_BULK_CHUNK];
 	u8 *buf;
 
 	if (swr == NULL) {
@@ -91,30 +119,23 @@ static int regmap_swr_raw_multi_reg_write(void *context, const void *data,
 	}
 	num_regs = count / (addr_bytes + val_bytes + pad_bytes);
 
-	reg = kcalloc(num_regs, sizeof(u16), GFP_KERNEL);
-	if (!reg)
-		return -ENOMEM;
-
-	val = kcalloc(num_regs, sizeof(u8), GFP_KERNEL);
-	if (!val) {
-		ret = -ENOMEM;
-		goto mem_fail;
-	}
-
+	/* Flush every REGMAP_SWR_BULK_CHUNK registers, no allocation */
 	buf = (u8 *)data;
 	for (i = 0; i < num_regs; i++) {
-		reg[i] = *(u16 *)buf;
+		reg[n] = *(u16 *)buf;
 		buf += (map->format.reg_bytes + map->format.pad_bytes);
-		val[i] = *buf;
+		val[n++] = *buf;
 		buf += map->format.val_bytes;
+		if (n < REGMAP_SWR_BULK_CHUNK && i + 1 < num_regs)
+			continue;
+		ret = swr_bulk_write(swr, swr->dev_num, reg, val, n);
+		if (ret) {
+			dev_err(dev, "%s: multi reg write failed\n", __func__);
+			break;
+		}
+		n = 0;
 	}
-	ret = swr_bulk_write(swr, swr->dev_num, reg, val, num_regs);
-	if (ret)
-		dev_err(dev, "%s: multi reg write failed\n", __func__);
 
-	kfree(val);
-mem_fail:
-	kfree(reg);
 	return ret;
 }
 
@@ -83,6 +83,13 @@
 
 #define SWR_OVERFLOW_RETRY_COUNT 30
 
+/* Command FIFO status polling, see swrm_poll_fifo_status() */
+#define SWRM_FIFO_POLL_MIN_US 2
+#define SWRM_FIFO_POLL_MAX_US 64
+#define SWRM_FIFO_POLL_TIMEOUT_US (SWR_OVERFLOW_RETRY_COUNT * 500)
+#define SWRM_FIFO_WR_OUTSTANDING(sts) (((sts) & 0x00001F00) >> 8)
+#define SWRM_FIFO_RD_AVAIL(sts) (((sts) & 0x001F0000) >> 16)
+
 #define CPU_IDLE_LATENCY 10
 
 /* pm runtime auto suspend timer in msecs */
@@ -116,6 +123,7 @@ enum {
 enum {
 	SWRM_WR_CHECK_AVAIL,
 	SWRM_RD_CHECK_AVAIL,
+	SWRM_WR_CHECK_EMPTY,
 };
 
 #define TRUE 1
@@ -652,28 +660,40 @@ static void swr_master_write(struct swr_mstr_ctrl *swrm, u16 reg_addr, u32 val)
 		swrm_ahb_write(swrm, reg_addr, &val);
 }
 
-static int swr_master_bulk_write(struct swr_mstr_ctrl *swrm, u32 *reg_addr,
-				u32 *val, unsigned int length)
+/* Caller holds iolock */
+static void __swr_master_bulk_write(struct swr_mstr_ctrl *swrm, u32 *reg_addr,
+				    u32 *val, unsigned int length)
 {
 	int i = 0;
 
+	if (swrm->bulk_write) {
+		swrm->bulk_write(swrm->handle, reg_addr, val, length);
+		return;
+	}
+	for (i = 0; i < length; i++) {
+	/* wait for FIFO WR command to complete to avoid overflow */
+	/*
+	 * Reduce sleep from 100us to 50us to meet KPIs
+	 * This still meets the hardware spec
+	 */
+		if (!swrm->fifo_poll)
+			usleep_range(50, 55);
+		if (reg_addr[i] == SWRM_CMD_FIFO_WR_CMD)
+			swrm_wait_for_fifo_avail(swrm, SWRM_WR_CHECK_AVAIL);
+		swr_master_write(swrm, reg_addr[i], val[i]);
+	}
+	if (!swrm->fifo_poll)
+		usleep_range(100, 110);
+}
+
+static int swr_master_bulk_write(struct swr_mstr_ctrl *swrm, u32 *reg_addr,
+				u32 *val, unsigned int length)
+{
 	if (swrm->bulk_write)
 		swrm->bulk_write(swrm->handle, reg_addr, val, length);
 	else {
 		mutex_lock(&swrm->iolock);
-		for (i = 0; i < length; i++) {
-		/* wait for FIFO WR command to complete to avoid overflow */
-		/*
-		 * Reduce sleep from 100us to 50us to meet KPIs
-		 * This still meets the hardware spec
-		 */
-			usleep_range(50, 55);
-			if (reg_addr[i] == SWRM_CMD_FIFO_WR_CMD)
-				swrm_wait_for_fifo_avail(swrm,
-							 SWRM_WR_CHECK_AVAIL);
-			swr_master_write(swrm, reg_addr[i], val[i]);
-		}
-		usleep_range(100, 110);
+		__swr_master_bulk_write(swrm, reg_addr, val, length);
 		mutex_unlock(&swrm->iolock);
 	}
 	return 0;
@@ -850,11 +870,78 @@ static u32 swrm_get_packed_reg_val(u8 *cmd_id, u8 cmd_data,
 	return val;
 }
 
+static bool swrm_fifo_status_met(struct swr_mstr_ctrl *swrm, u32 sts,
+				 int check)
+{
+	switch (check) {
+	case SWRM_RD_CHECK_AVAIL:
+		return SWRM_FIFO_RD_AVAIL(sts) > 0;
+	case SWRM_WR_CHECK_EMPTY:
+		return SWRM_FIFO_WR_OUTSTANDING(sts) == 0;
+	case SWRM_WR_CHECK_AVAIL:
+	default:
+		return SWRM_FIFO_WR_OUTSTANDING(sts) < swrm->wr_fifo_depth;
+	}
+}
+
+/*
+ * Poll the command FIFO status until the condition selected by @check is
+ * met: a read response is available, the write FIFO has room or the
+ * write FIFO has drained. The poll interval starts at a few microseconds
+ * and doubles up to SWRM_FIFO_POLL_MAX_US, short waits busy-wait and only
+ * longer ones sleep. Returns false on timeout.
+ */
+static bool swrm_poll_fifo_status(struct swr_mstr_ctrl *swrm, int check)
+{
+	u32 step = SWRM_FIFO_POLL_MIN_US;
+	u32 waited = 0;
+	u32 sts;
+
+	for (;;) {
+		sts = swr_master_read(swrm, SWRM_CMD_FIFO_STATUS);
+		if (swrm_fifo_status_met(swrm, sts, check))
+			return true;
+		if (waited >= SWRM_FIFO_POLL_TIMEOUT_US)
+			return false;
+		if (step < SWRM_FIFO_POLL_MAX_US)
+			udelay(step);
+		else
+			usleep_range(step, step + 10);
+		waited += step;
+		step = min_t(u32, step << 1, SWRM_FIFO_POLL_MAX_US);
+	}
+}
+
+/*
+ * In FIFO poll mode writes return once they are queued. Wait for the
+ * write FIFO to drain before the bus is clock stopped or its clock is
+ * released, so no posted write is lost.
+ */
+static void swrm_drain_wr_fifo(struct swr_mstr_ctrl *swrm)
+{
+	if (!swrm->fifo_poll)
+		return;
+
+	mutex_lock(&swrm->iolock);
+	if (!swrm_poll_fifo_status(swrm, SWRM_WR_CHECK_EMPTY))
+		dev_err_ratelimited(swrm->dev, "%s: write fifo not drained\n",
+				    __func__);
+	mutex_unlock(&swrm->iolock);
+}
+
 static void swrm_wait_for_fifo_avail(struct swr_mstr_ctrl *swrm, int swrm_rd_wr)
 {
 	u32 fifo_outstanding_cmd;
 	u32 fifo_retry_count = SWR_OVERFLOW_RETRY_COUNT;
 
+	if (swrm->fifo_poll) {
+		if (!swrm_poll_fifo_status(swrm, swrm_rd_wr))
+			dev_err_ratelimited(swrm->dev, "%s err %s\n", __func__,
+				swrm_rd_wr ? "read underflow" :
+					     "write overflow");
+		return;
+	}
+
 	if (swrm_rd_wr) {
 		/* Check for fifo underflow during read */
 		/* Check no of outstanding commands in fifo before read */
@@ -910,6 +997,13 @@ static int swrm_cmd_fifo_rd_cmd(struct swr_mstr_ctrl *swrm, int *cmd_data,
 	if (swrm->read) {
 		/* skip delay if read is handled in platform driver */
 		swr_master_write(swrm, SWRM_CMD_FIFO_RD_CMD, val);
+	} else if (swrm->fifo_poll) {
+		/*
+		 * Queue behind any outstanding writes, completion is detected
+		 * by polling the read FIFO below.
+		 */
+		swrm_wait_for_fifo_avail(swrm, SWRM_WR_CHECK_AVAIL);
+		swr_master_write(swrm, SWRM_CMD_FIFO_RD_CMD, val);
 	} else {
 		/*
 		 * Check for outstanding cmd wrt. write fifo depth to avoid
@@ -978,8 +1072,10 @@ static int swrm_cmd_fifo_wr_cmd(struct swr_mstr_ctrl *swrm, u8 cmd_data,
 	/*
 	 * wait for FIFO WR command to complete to avoid overflow
 	 * skip delay if write is handled in platform driver.
+	 * In FIFO poll mode writes are pipelined up to the FIFO depth,
+	 * the next command waits for room in swrm_wait_for_fifo_avail().
 	 */
-	if(!swrm->write)
+	if (!swrm->write && !swrm->fifo_poll)
 		usleep_range(150, 155);
 	if (cmd_id == 0xF) {
 		/*
@@ -1069,9 +1165,7 @@ static int swrm_bulk_write(struct swr_master *master, u8 dev_num, void *reg,
 {
 	struct swr_mstr_ctrl *swrm = swr_get_ctrl_data(master);
 	int ret = 0;
-	int i;
-	u32 *val;
-	u32 *swr_fifo_reg;
+	size_t i, done, chunk;
 
 	if (!swrm || !swrm->handle) {
 		dev_err(&master->dev, "%s: swrm is NULL\n", __func__);
@@ -1087,42 +1181,38 @@ static int swrm_bulk_write(struct swr_master *master, u8 dev_num, void *reg,
 	mutex_unlock(&swrm->devlock);
 
 	pm_runtime_get_sync(swrm->dev);
+	if (swrm->req_clk_switch)
+		swrm_runtime_resume(swrm->dev);
 	if (dev_num) {
-		swr_fifo_reg = kcalloc(len, sizeof(u32), GFP_KERNEL);
-		if (!swr_fifo_reg) {
-			ret = -ENOMEM;
-			goto err;
-		}
-		val = kcalloc(len, sizeof(u32), GFP_KERNEL);
-		if (!val) {
-			ret = -ENOMEM;
-			goto mem_fail;
-		}
-
-		for (i = 0; i < len; i++) {
-			val[i] = swrm_get_packed_reg_val(&swrm->wcmd_id,
-							 ((u8 *)buf)[i],
-							 dev_num,
-							 ((u16 *)reg)[i]);
-			swr_fifo_reg[i] = SWRM_CMD_FIFO_WR_CMD;
-		}
-		ret = swr_master_bulk_write(swrm, swr_fifo_reg, val, len);
-		if (ret) {
-			dev_err(&master->dev, "%s: bulk write failed\n",
-				__func__);
-			ret = -EINVAL;
+		/*
+		 * Pack into the preallocated buffers, one FIFO batch of
+		 * at most SWRM_BULK_WRITE_MAX_LEN commands at a time.
+		 * iolock covers the buffers and keeps wcmd_id in step
+		 * with the order the commands reach the FIFO.
+		 */
+		mutex_lock(&swrm->iolock);
+		for (done = 0; done < len; done += chunk) {
+			chunk = min_t(size_t, len - done,
+				      SWRM_BULK_WRITE_MAX_LEN);
+			for (i = 0; i < chunk; i++) {
+				swrm->bulk_val[i] = swrm_get_packed_reg_val(
+						&swrm->wcmd_id,
+						((u8 *)buf)[done + i],
+						dev_num,
+						((u16 *)reg)[done + i]);
+				swrm->bulk_reg[i] = SWRM_CMD_FIFO_WR_CMD;
+			}
+			__swr_master_bulk_write(swrm, swrm->bulk_reg,
+						swrm->bulk_val, chunk);
 		}
+		mutex_unlock(&swrm->iolock);
 	} else {
 		dev_err(&master->dev,
 			"%s: No support of Bulk write for master regs\n",
 			__func__);
 		ret = -EINVAL;
-		goto err;
 	}
-	kfree(val);
-mem_fail:
-	kfree(swr_fifo_reg);
-err:
+
 	pm_runtime_put_autosuspend(swrm->dev);
 	pm_runtime_mark_last_busy(swrm->dev);
 	return ret;
@@ -2852,6 +2942,15 @@ static int swrm_probe(struct platform_device *pdev)
 	if (ret)
 		dev_dbg(&pdev->dev, "%s: failed to get is_always_on flag\n", __func__);
 
+	/*
+	 * qcom,swr-fifo-poll: optional boolean. When present, command FIFO
+	 * accesses poll SWRM_CMD_FIFO_STATUS instead of sleeping fixed
+	 * delays, and writes return once queued in the FIFO. The FIFO is
+	 * drained before clock stop and suspend.
+	 */
+	swrm->fifo_poll = of_property_read_bool(pdev->dev.of_node,
+						"qcom,swr-fifo-poll");
+
 	swrm->reg_irq = pdata->reg_irq;
 	swrm->master.read = swrm_read;
 	swrm->master.write = swrm_write;
@@ -3368,6 +3467,7 @@ static int swrm_runtime_suspend(struct device *dev)
 			if (swrm->state == SWR_MSTR_SSR)
 				goto chk_lnk_status;
 			mutex_unlock(&swrm->reslock);
+			swrm_drain_wr_fifo(swrm);
 			enable_bank_switch(swrm, 0, SWR_ROW_50, SWR_MIN_COL);
 			mutex_lock(&swrm->reslock);
 			swrm_clk_pause(swrm);
@@ -3403,6 +3503,7 @@ static int swrm_runtime_suspend(struct device *dev)
 					 SWRM_CPU1_INTERRUPT_EN,
 					 swrm->intr_mask);
 			mutex_unlock(&swrm->reslock);
+			swrm_drain_wr_fifo(swrm);
 			/* clock stop sequence */
 			swrm_cmd_fifo_wr_cmd(swrm, 0x2, 0xF, 0xF,
 					SWRS_SCP_CONTROL);
@@ -46,6 +46,8 @@
 
 #define SWRM_NUM_AUTO_ENUM_SLAVES    11
 
+#define SWRM_BULK_WRITE_MAX_LEN 64 /* Commands per bulk write batch */
+
 enum {
 	SWR_MSTR_PAUSE,
 	SWR_MSTR_RESUME,
@@ -202,6 +204,9 @@ struct swr_mstr_ctrl {
 	bool enable_slave_irq;
 	u32 is_always_on;
 	bool clk_stop_wakeup;
+	bool fifo_poll;
+	u32 bulk_reg[SWRM_BULK_WRITE_MAX_LEN];
+	u32 bulk_val[SWRM_BULK_WRITE_MAX_LEN];
 	struct swr_port_params pp[SWR_UC_MAX][SWR_MAX_MSTR_PORT_NUM];/*max_devNum * max_ports 11 * 14 */
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_swrm_dent;
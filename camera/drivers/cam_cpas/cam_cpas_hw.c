@@ -175,12 +175,69 @@ end:
 	return rc;
 }
 
+static void cam_cpas_util_update_vote_stats(
+	struct cam_cpas_bus_client *bus_client, uint64_t quant_ab,
+	uint64_t quant_ib)
+{
+	struct cam_cpas_vote_stats *stats = &bus_client->vote_stats;
+	int dir;
+
+	if ((quant_ab + quant_ib) > (bus_client->curr_ab + bus_client->curr_ib))
+		dir = 1;
+	else if ((quant_ab + quant_ib) <
+		(bus_client->curr_ab + bus_client->curr_ib))
+		dir = -1;
+	else
+		dir = 0;
+
+	if (dir && stats->last_dir && (dir != stats->last_dir))
+		stats->num_reversals++;
+	if (dir)
+		stats->last_dir = dir;
+
+	stats->num_applied++;
+	bus_client->curr_ab = quant_ab;
+	bus_client->curr_ib = quant_ib;
+}
+
+static void cam_cpas_util_reset_vote_stats(
+	struct cam_cpas_bus_client *bus_client)
+{
+	if (!bus_client->valid)
+		return;
+
+	mutex_lock(&bus_client->lock);
+	memset(&bus_client->vote_stats, 0, sizeof(bus_client->vote_stats));
+	bus_client->vote_stats.start_ts = ktime_get();
+	mutex_unlock(&bus_client->lock);
+}
+
+static void cam_cpas_util_print_vote_stats(
+	struct cam_cpas_bus_client *bus_client)
+{
+	struct cam_cpas_vote_stats *stats = &bus_client->vote_stats;
+	uint64_t elapsed_ms;
+
+	if (!bus_client->valid)
+		return;
+
+	/* Called from error paths as well, counters are read unlocked */
+	elapsed_ms = ktime_ms_delta(ktime_get(), stats->start_ts);
+	CAM_INFO(CAM_CPAS,
+		"[%s] bw votes requested[%llu] applied[%llu] reversals[%llu] applied rate[%llu/s]",
+		bus_client->common_data.name, stats->num_requests,
+		stats->num_applied, stats->num_reversals,
+		elapsed_ms ? div64_u64(stats->num_applied * 1000, elapsed_ms) :
+		stats->num_applied);
+}
+
 static int cam_cpas_util_vote_bus_client_bw(
 	struct cam_cpas_bus_client *bus_client, uint64_t ab, uint64_t ib,
 	bool camnoc_bw, uint64_t *applied_ab, uint64_t *applied_ib)
 {
 	int rc = 0;
 	uint64_t min_camnoc_ib_bw = CAM_CPAS_AXI_MIN_CAMNOC_IB_BW;
+	uint64_t quant_ab, quant_ib;
 	const struct camera_debug_settings *cam_debug = NULL;
 
 	if (!bus_client->valid) {
@@ -228,6 +285,21 @@ static int cam_cpas_util_vote_bus_client_bw(
 		cam_cpas_process_bw_overrides(bus_client, &ab, &ib,
 			&cam_debug->cpas_settings);
 
+	bus_client->vote_stats.num_requests++;
+
+	/*
+	 * Tree updates that do not move the interconnect vote by at least one
+	 * quantum are not forwarded, the previous vote is still in effect.
+	 */
+	quant_ab = div_u64(ab, CAM_CPAS_AXI_VOTE_QUANTUM);
+	quant_ib = div_u64(ib, CAM_CPAS_AXI_VOTE_QUANTUM);
+	if ((quant_ab == bus_client->curr_ab) &&
+		(quant_ib == bus_client->curr_ib)) {
+		CAM_DBG(CAM_PERF, "Bus client=[%s] :ab[%llu] ib[%llu] unchanged",
+			bus_client->common_data.name, ab, ib);
+		goto update_applied;
+	}
+
 	rc = cam_soc_bus_client_update_bw(bus_client->soc_bus_client, ab, ib);
 	if (rc) {
 		CAM_ERR(CAM_CPAS,
@@ -236,6 +308,9 @@ static int cam_cpas_util_vote_bus_client_bw(
 		goto unlock_client;
 	}
 
+	cam_cpas_util_update_vote_stats(bus_client, quant_ab, quant_ib);
+
+update_applied:
 	if (applied_ab)
 		*applied_ab = ab;
 	if (applied_ib)
@@ -261,6 +336,10 @@ static int cam_cpas_util_register_bus_client(
 		return rc;
 	}
 	bus_client->curr_vote_level = 0;
+	bus_client->curr_ab = 0;
+	bus_client->curr_ib = 0;
+	memset(&bus_client->vote_stats, 0, sizeof(bus_client->vote_stats));
+	bus_client->vote_stats.start_ts = ktime_get();
 	bus_client->valid = true;
 	mutex_init(&bus_client->lock);
 
@@ -277,6 +356,8 @@ static int cam_cpas_util_unregister_bus_client(
 
 	cam_soc_bus_client_unregister(&bus_client->soc_bus_client);
 	bus_client->curr_vote_level = 0;
+	bus_client->curr_ab = 0;
+	bus_client->curr_ib = 0;
 	bus_client->valid = false;
 	mutex_destroy(&bus_client->lock);
 
@@ -844,16 +925,19 @@ static int cam_cpas_axi_consolidate_path_votes(
 	struct cam_cpas_client *cpas_client,
 	struct cam_axi_vote *axi_vote)
 {
-	int rc = 0, i, k, l;
+	int rc = 0, i, k;
 	struct cam_axi_vote *con_axi_vote = &cpas_client->axi_vote;
-	bool path_found = false, cons_entry_found;
+	bool path_found = false;
 	struct cam_cpas_tree_node *curr_tree_node = NULL;
 	struct cam_cpas_tree_node *sum_tree_node = NULL;
 	uint32_t transac_type;
 	uint32_t path_data_type;
 	struct cam_axi_per_path_bw_vote *axi_path;
+	/* Index of each consolidated path in con_axi_vote, -1 if not added */
+	int8_t con_idx[CAM_CPAS_PATH_DATA_MAX][CAM_CPAS_TRANSACTION_MAX];
 
 	con_axi_vote->num_paths = 0;
+	memset(con_idx, -1, sizeof(con_idx));
 
 	for (i = 0; i < axi_vote->num_paths; i++) {
 		path_found = false;
@@ -875,6 +959,8 @@ static int cam_cpas_axi_consolidate_path_votes(
 			path_found = true;
 			memcpy(axi_path, &axi_vote->axi_path[i],
 				sizeof(struct cam_axi_per_path_bw_vote));
+			con_idx[path_data_type][transac_type] =
+				con_axi_vote->num_paths;
 			con_axi_vote->num_paths++;
 			continue;
 		}
@@ -888,46 +974,33 @@ static int cam_cpas_axi_consolidate_path_votes(
 			if (sum_tree_node->constituent_paths[path_data_type]) {
 				path_found = true;
 				/*
-				 * Check if corresponding consolidated path
-				 * entry is already added into consolidated list
+				 * Accumulate into the consolidated path entry
+				 * if it is already in the consolidated list
 				 */
-				cons_entry_found = false;
-				for (l = 0; l < con_axi_vote->num_paths; l++) {
-					if ((con_axi_vote->axi_path[l]
-					.path_data_type == k) &&
-					(con_axi_vote->axi_path[l]
-					.transac_type == transac_type)) {
-						cons_entry_found = true;
-						con_axi_vote->axi_path[l]
-						.camnoc_bw +=
-						axi_vote->axi_path[i]
-						.camnoc_bw;
-
-						con_axi_vote->axi_path[l]
-						.mnoc_ab_bw +=
-						axi_vote->axi_path[i]
-						.mnoc_ab_bw;
-
-						con_axi_vote->axi_path[l]
-						.mnoc_ib_bw +=
-						axi_vote->axi_path[i]
-						.mnoc_ib_bw;
-						break;
-					}
+				if (con_idx[k][transac_type] >= 0) {
+					axi_path = &con_axi_vote->axi_path[
+						con_idx[k][transac_type]];
+					axi_path->camnoc_bw +=
+						axi_vote->axi_path[i].camnoc_bw;
+					axi_path->mnoc_ab_bw +=
+						axi_vote->axi_path[i].mnoc_ab_bw;
+					axi_path->mnoc_ib_bw +=
+						axi_vote->axi_path[i].mnoc_ib_bw;
+					break;
 				}
 
 				/* If not found, add a new entry */
-				if (!cons_entry_found) {
-					axi_path->path_data_type = k;
-					axi_path->transac_type = transac_type;
-					axi_path->camnoc_bw =
+				axi_path->path_data_type = k;
+				axi_path->transac_type = transac_type;
+				axi_path->camnoc_bw =
 					axi_vote->axi_path[i].camnoc_bw;
-					axi_path->mnoc_ab_bw =
+				axi_path->mnoc_ab_bw =
 					axi_vote->axi_path[i].mnoc_ab_bw;
-					axi_path->mnoc_ib_bw =
+				axi_path->mnoc_ib_bw =
 					axi_vote->axi_path[i].mnoc_ib_bw;
-					con_axi_vote->num_paths++;
-				}
+				con_idx[k][transac_type] =
+					con_axi_vote->num_paths;
+				con_axi_vote->num_paths++;
 				break;
 			}
 		}
@@ -1180,6 +1253,16 @@ static int cam_cpas_util_apply_client_axi_vote(
 				goto unlock_tree;
 			}
 
+			/*
+			 * Only the delta is propagated, once a level absorbs
+			 * it (e.g. interleave rounding) the ancestors and the
+			 * port vote are unchanged.
+			 */
+			if ((par_tree_node->camnoc_bw == par_camnoc_old) &&
+				(par_tree_node->mnoc_ab_bw == par_mnoc_ab_old) &&
+				(par_tree_node->mnoc_ib_bw == par_mnoc_ib_old))
+				break;
+
 			if (!par_tree_node->parent_node) {
 				if ((par_tree_node->axi_port_idx < 0) ||
 					(par_tree_node->axi_port_idx >=
@@ -2213,6 +2296,8 @@ static int cam_cpas_log_vote(struct cam_hw_info *cpas_hw)
 			cpas_core->axi_port[i].additional_bw,
 			cpas_core->axi_port[i].applied_ab_bw,
 			cpas_core->axi_port[i].applied_ib_bw);
+		cam_cpas_util_print_vote_stats(
+			&cpas_core->axi_port[i].bus_client);
 	}
 
 	if (soc_private->control_camnoc_axi_clk) {
@@ -2228,6 +2313,8 @@ static int cam_cpas_log_vote(struct cam_hw_info *cpas_hw)
 				cpas_core->camnoc_axi_port[i].additional_bw,
 				cpas_core->camnoc_axi_port[i].applied_ab_bw,
 				cpas_core->camnoc_axi_port[i].applied_ib_bw);
+			cam_cpas_util_print_vote_stats(
+				&cpas_core->camnoc_axi_port[i].bus_client);
 		}
 	}
 
@@ -2954,6 +3041,29 @@ static int cam_cpas_util_get_internal_ops(struct platform_device *pdev,
 	return rc;
 }
 
+static int cam_cpas_set_vote_stats_reset(void *data, u64 val)
+{
+	struct cam_cpas *cpas_core = data;
+	int i;
+
+	if (!val)
+		return 0;
+
+	mutex_lock(&cpas_core->tree_lock);
+	for (i = 0; i < cpas_core->num_axi_ports; i++)
+		cam_cpas_util_reset_vote_stats(
+			&cpas_core->axi_port[i].bus_client);
+	for (i = 0; i < cpas_core->num_camnoc_axi_ports; i++)
+		cam_cpas_util_reset_vote_stats(
+			&cpas_core->camnoc_axi_port[i].bus_client);
+	mutex_unlock(&cpas_core->tree_lock);
+
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(cam_cpas_vote_stats_reset_fops, NULL,
+	cam_cpas_set_vote_stats_reset, "%llu\n");
+
 static int cam_cpas_util_create_debugfs(struct cam_cpas *cpas_core)
 {
 	int rc = 0;
@@ -2976,6 +3086,9 @@ static int cam_cpas_util_create_debugfs(struct cam_cpas *cpas_core)
 
 	debugfs_create_bool("smart_qos_dump", 0644,
 		cpas_core->dentry, &cpas_core->smart_qos_dump);
+
+	debugfs_create_file("axi_vote_stats_reset", 0200,
+		cpas_core->dentry, cpas_core, &cam_cpas_vote_stats_reset_fops);
 end:
 	return rc;
 }
@@ -29,6 +29,9 @@
 #define CAM_CPAS_AXI_MIN_CAMNOC_AB_BW (2048 * 1024)
 #define CAM_CPAS_AXI_MIN_CAMNOC_IB_BW (3000000000UL)
 
+/* Interconnect votes are carried in kBps, finer changes are not applied */
+#define CAM_CPAS_AXI_VOTE_QUANTUM     1000
+
 #define CAM_CPAS_GET_CLIENT_IDX(handle) (handle)
 #define CAM_CPAS_GET_CLIENT_HANDLE(indx) (indx)
 
@@ -144,6 +147,24 @@ struct cam_cpas_client {
 		[CAM_CPAS_TRANSACTION_MAX];
 };
 
+/**
+ * struct cam_cpas_vote_stats : Bandwidth vote statistics of a bus client
+ *
+ * @num_requests: Number of bw vote requests made on the client
+ * @num_applied: Number of requests that reached the interconnect
+ * @num_reversals: Number of applied votes that reversed the direction
+ *                 (increase/decrease) of the previous applied vote
+ * @last_dir: Direction of the last applied vote, -1, 0 or 1
+ * @start_ts: Time at which the statistics were last reset
+ */
+struct cam_cpas_vote_stats {
+	uint64_t num_requests;
+	uint64_t num_applied;
+	uint64_t num_reversals;
+	int last_dir;
+	ktime_t start_ts;
+};
+
 /**
  * struct cam_cpas_bus_client : Bus client information
  *
@@ -151,6 +172,9 @@ struct cam_cpas_client {
  * @name: Name of the bus client
  * @lock: Mutex lock used while voting on this client
  * @curr_vote_level: current voted index
+ * @curr_ab: Quantized ab bw currently voted on the interconnect
+ * @curr_ib: Quantized ib bw currently voted on the interconnect
+ * @vote_stats: Bandwidth vote statistics
  * @common_data: Common data fields for bus client
  * @soc_bus_client: Bus client private information
  */
@@ -158,6 +182,9 @@ struct cam_cpas_bus_client {
 	bool valid;
 	struct mutex lock;
 	unsigned int curr_vote_level;
+	uint64_t curr_ab;
+	uint64_t curr_ib;
+	struct cam_cpas_vote_stats vote_stats;
 	struct cam_soc_bus_client_common_data common_data;
 	void *soc_bus_client;
 };
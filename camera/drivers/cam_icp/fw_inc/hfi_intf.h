@@ -78,6 +78,24 @@ struct hfi_mini_dump_info {
 	bool           msg_q_state;
 	bool           cmd_q_state;
 };
+
+/**
+ * struct hfi_msg_view
+ * @seg: start of the contiguous runs of pending data in the queue
+ * @seg_words: number of words in each run, the second run is
+ *             non-empty only when pending data wraps around the queue
+ * @total_words: total number of pending words
+ * @next_read_idx: read index published on consume
+ * @q_id: queue the view refers to
+ */
+struct hfi_msg_view {
+	uint32_t      *seg[2];
+	uint32_t       seg_words[2];
+	uint32_t       total_words;
+	uint32_t       next_read_idx;
+	uint8_t        q_id;
+};
+
 /**
  * hfi_write_cmd() - function for hfi write
  * @cmd_ptr: pointer to command data for hfi write
@@ -97,6 +115,25 @@ int hfi_write_cmd(void *cmd_ptr);
  */
 int hfi_read_message(uint32_t *pmsg, uint8_t q_id, uint32_t *words_read);
 
+/**
+ * hfi_peek_message() - map pending data of a queue without copying
+ * @q_id: queue id, Q_MSG or Q_DBG
+ * @view: filled with the location of all pending words in the queue
+ *
+ * On success the message queue lock is held and the caller must call
+ * hfi_consume_message() once done parsing, the read index is not
+ * advanced until then.
+ *
+ * Returns success(zero)/failure(non zero)
+ */
+int hfi_peek_message(uint8_t q_id, struct hfi_msg_view *view);
+
+/**
+ * hfi_consume_message() - release data mapped by hfi_peek_message()
+ * @view: view returned by a successful hfi_peek_message()
+ */
+void hfi_consume_message(struct hfi_msg_view *view);
+
 /**
  * hfi_init() - function initialize hfi after firmware download
  * @hfi_mem: hfi memory info
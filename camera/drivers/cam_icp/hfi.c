@@ -252,22 +252,22 @@ err:
 	return rc;
 }
 
-int hfi_read_message(uint32_t *pmsg, uint8_t q_id,
-	uint32_t *words_read)
+int hfi_peek_message(uint8_t q_id, struct hfi_msg_view *view)
 {
 	struct hfi_qtbl *q_tbl_ptr;
 	struct hfi_q_hdr *q;
-	uint32_t new_read_idx, size_in_words, word_diff, temp;
-	uint32_t *read_q, *read_ptr, *write_ptr;
+	uint32_t read_idx, write_idx, q_size_in_words;
+	uint32_t size_in_words, tail_words;
+	uint32_t *read_q;
 	uint32_t size_upper_bound = 0;
 	int rc = 0;
 
-	if (!pmsg) {
-		CAM_ERR(CAM_HFI, "Invalid msg");
+	if (!view) {
+		CAM_ERR(CAM_HFI, "Invalid view");
 		return -EINVAL;
 	}
 
-	if (q_id > Q_DBG) {
+	if (q_id > Q_DBG || q_id == Q_CMD) {
 		CAM_ERR(CAM_HFI, "Invalid q :%u", q_id);
 		return -EINVAL;
 	}
@@ -290,9 +290,13 @@ int hfi_read_message(uint32_t *pmsg, uint8_t q_id,
 	q_tbl_ptr = (struct hfi_qtbl *)g_hfi->map.qtbl.kva;
 	q = &q_tbl_ptr->q_hdr[q_id];
 
-	if (q->qhdr_read_idx == q->qhdr_write_idx) {
+	/* Firmware may advance the write index while we parse, snapshot it */
+	read_idx = q->qhdr_read_idx;
+	write_idx = READ_ONCE(q->qhdr_write_idx);
+
+	if (read_idx == write_idx) {
 		CAM_DBG(CAM_HFI, "Q not ready, state:%u, r idx:%u, w idx:%u",
-			g_hfi->hfi_state, q->qhdr_read_idx, q->qhdr_write_idx);
+			g_hfi->hfi_state, read_idx, write_idx);
 		rc = -EIO;
 		goto err;
 	}
@@ -300,56 +304,90 @@ int hfi_read_message(uint32_t *pmsg, uint8_t q_id,
 	if (q_id == Q_MSG) {
 		read_q = (uint32_t *)g_hfi->map.msg_q.kva;
 		size_upper_bound = ICP_HFI_MAX_PKT_SIZE_MSGQ_IN_WORDS;
+		q_size_in_words = ICP_MSG_Q_SIZE_IN_BYTES >> BYTE_WORD_SHIFT;
 	} else {
 		read_q = (uint32_t *)g_hfi->map.dbg_q.kva;
 		size_upper_bound = ICP_HFI_MAX_PKT_SIZE_IN_WORDS;
+		q_size_in_words = ICP_DBG_Q_SIZE_IN_BYTES >> BYTE_WORD_SHIFT;
 	}
 
-	read_ptr = (uint32_t *)(read_q + q->qhdr_read_idx);
-	write_ptr = (uint32_t *)(read_q + q->qhdr_write_idx);
-
-	if (write_ptr > read_ptr)
-		size_in_words = write_ptr - read_ptr;
-	else {
-		word_diff = read_ptr - write_ptr;
-		if (q_id == Q_MSG)
-			size_in_words = (ICP_MSG_Q_SIZE_IN_BYTES >>
-			BYTE_WORD_SHIFT) - word_diff;
-		else
-			size_in_words = (ICP_DBG_Q_SIZE_IN_BYTES >>
-			BYTE_WORD_SHIFT) - word_diff;
-	}
+	if (write_idx > read_idx)
+		size_in_words = write_idx - read_idx;
+	else
+		size_in_words = q_size_in_words - (read_idx - write_idx);
 
 	if ((size_in_words == 0) ||
 		(size_in_words > size_upper_bound)) {
 		CAM_ERR(CAM_HFI, "invalid HFI message packet size - 0x%08x",
 			size_in_words << BYTE_WORD_SHIFT);
-		q->qhdr_read_idx = q->qhdr_write_idx;
+		q->qhdr_read_idx = write_idx;
 		rc = -EIO;
 		goto err;
 	}
 
-	new_read_idx = q->qhdr_read_idx + size_in_words;
-
-	if (new_read_idx < q->qhdr_q_size) {
-		memcpy(pmsg, read_ptr, size_in_words << BYTE_WORD_SHIFT);
+	/* Make sure queue contents are read after the write index */
+	rmb();
+
+	tail_words = q->qhdr_q_size - read_idx;
+	view->q_id = q_id;
+	view->total_words = size_in_words;
+	view->seg[0] = read_q + read_idx;
+	if (size_in_words < tail_words) {
+		view->seg_words[0] = size_in_words;
+		view->seg[1] = NULL;
+		view->seg_words[1] = 0;
+		view->next_read_idx = read_idx + size_in_words;
 	} else {
-		new_read_idx -= q->qhdr_q_size;
-		temp = (size_in_words - new_read_idx) << BYTE_WORD_SHIFT;
-		memcpy(pmsg, read_ptr, temp);
-		memcpy((uint8_t *)pmsg + temp, read_q,
-			new_read_idx << BYTE_WORD_SHIFT);
+		view->seg_words[0] = tail_words;
+		view->seg[1] = read_q;
+		view->seg_words[1] = size_in_words - tail_words;
+		view->next_read_idx = size_in_words - tail_words;
 	}
 
-	q->qhdr_read_idx = new_read_idx;
-	*words_read = size_in_words;
+	/* hfi_msg_q_mutex is released by hfi_consume_message() */
+	return 0;
+err:
+	mutex_unlock(&hfi_msg_q_mutex);
+	return rc;
+}
+
+void hfi_consume_message(struct hfi_msg_view *view)
+{
+	struct hfi_qtbl *q_tbl_ptr;
+
+	q_tbl_ptr = (struct hfi_qtbl *)g_hfi->map.qtbl.kva;
+	q_tbl_ptr->q_hdr[view->q_id].qhdr_read_idx = view->next_read_idx;
 	/* Memory Barrier to make sure message
 	 * queue parameters are updated after read
 	 */
 	wmb();
-err:
 	mutex_unlock(&hfi_msg_q_mutex);
-	return rc;
+}
+
+int hfi_read_message(uint32_t *pmsg, uint8_t q_id,
+	uint32_t *words_read)
+{
+	struct hfi_msg_view view;
+	int rc;
+
+	if (!pmsg) {
+		CAM_ERR(CAM_HFI, "Invalid msg");
+		return -EINVAL;
+	}
+
+	rc = hfi_peek_message(q_id, &view);
+	if (rc)
+		return rc;
+
+	memcpy(pmsg, view.seg[0], view.seg_words[0] << BYTE_WORD_SHIFT);
+	if (view.seg_words[1])
+		memcpy(pmsg + view.seg_words[0], view.seg[1],
+			view.seg_words[1] << BYTE_WORD_SHIFT);
+
+	*words_read = view.total_words;
+	hfi_consume_message(&view);
+
+	return 0;
 }
 
 int hfi_cmd_ubwc_config(uint32_t *ubwc_cfg)
@@ -2570,22 +2570,68 @@ static int cam_icp_mgr_process_fatal_error(
 	return rc;
 }
 
+/*
+ * Returns a contiguous pointer to the packet at word offset @off of a
+ * queue view. Packets that straddle the end of the ring are assembled
+ * in @bounce, all others are parsed in place.
+ */
+static uint32_t *cam_icp_mgr_get_view_pkt(struct hfi_msg_view *view,
+	uint32_t off, uint32_t *bounce, uint32_t bounce_words)
+{
+	uint32_t *pkt_ptr;
+	uint32_t avail, pkt_words;
+
+	if (off < view->seg_words[0]) {
+		pkt_ptr = view->seg[0] + off;
+		avail = view->seg_words[0] - off;
+	} else {
+		pkt_ptr = view->seg[1] + (off - view->seg_words[0]);
+		avail = view->total_words - off;
+	}
+
+	pkt_words = pkt_ptr[ICP_PACKET_SIZE] >> BYTE_WORD_SHIFT;
+	if (!pkt_words || (pkt_words > view->total_words - off)) {
+		CAM_ERR(CAM_ICP, "Invalid pkt size: %u off: %u total: %u",
+			pkt_words, off, view->total_words);
+		return NULL;
+	}
+
+	if (pkt_words <= avail)
+		return pkt_ptr;
+
+	if (pkt_words > bounce_words) {
+		CAM_ERR(CAM_ICP, "Pkt size: %u exceeds bounce buffer: %u",
+			pkt_words, bounce_words);
+		return NULL;
+	}
+
+	memcpy(bounce, pkt_ptr, avail << BYTE_WORD_SHIFT);
+	memcpy(bounce + avail, view->seg[1],
+		(pkt_words - avail) << BYTE_WORD_SHIFT);
+
+	return bounce;
+}
+
 static void cam_icp_mgr_process_dbg_buf(unsigned int debug_lvl)
 {
-	uint32_t *msg_ptr = NULL, *pkt_ptr = NULL;
+	uint32_t *pkt_ptr = NULL;
 	struct hfi_msg_debug *dbg_msg;
-	uint32_t read_len, size_processed = 0;
+	struct hfi_msg_view view;
+	uint32_t size_processed = 0;
 	uint64_t timestamp = 0;
 	char *dbg_buf;
 	int rc = 0;
 
-	rc = hfi_read_message(icp_hw_mgr.dbg_buf, Q_DBG, &read_len);
+	rc = hfi_peek_message(Q_DBG, &view);
 	if (rc)
 		return;
 
-	msg_ptr = (uint32_t *)icp_hw_mgr.dbg_buf;
-	while (true) {
-		pkt_ptr = msg_ptr;
+	while (size_processed < view.total_words) {
+		pkt_ptr = cam_icp_mgr_get_view_pkt(&view, size_processed,
+			icp_hw_mgr.dbg_buf, ICP_DBG_BUF_SIZE);
+		if (!pkt_ptr)
+			break;
+
 		if (pkt_ptr[ICP_PACKET_TYPE] == HFI_MSG_SYS_DEBUG) {
 			dbg_msg = (struct hfi_msg_debug *)pkt_ptr;
 			dbg_buf = (char *)&dbg_msg->msg_data;
@@ -2597,14 +2643,9 @@ static void cam_icp_mgr_process_dbg_buf(unsigned int debug_lvl)
 		}
 		size_processed += (pkt_ptr[ICP_PACKET_SIZE] >>
 			BYTE_WORD_SHIFT);
-		if (size_processed >= read_len)
-			return;
-		msg_ptr += (pkt_ptr[ICP_PACKET_SIZE] >>
-		BYTE_WORD_SHIFT);
-		pkt_ptr = NULL;
-		dbg_msg = NULL;
-		dbg_buf = NULL;
 	}
+
+	hfi_consume_message(&view);
 }
 
 static int cam_icp_process_msg_pkt_type(
@@ -2676,13 +2717,45 @@ static int cam_icp_process_msg_pkt_type(
 	return rc;
 }
 
+static int cam_icp_mgr_process_msg_buf(struct cam_icp_hw_mgr *hw_mgr,
+	uint32_t *msg_buf, uint32_t read_len)
+{
+	uint32_t msg_processed_len, pkt_words, size_processed = 0;
+	uint32_t *msg_ptr;
+	int rc = 0;
+
+	while (size_processed < read_len) {
+		msg_ptr = msg_buf + size_processed;
+		pkt_words = msg_ptr[ICP_PACKET_SIZE] >> BYTE_WORD_SHIFT;
+		if (!pkt_words || (pkt_words > read_len - size_processed)) {
+			CAM_ERR(CAM_ICP, "Invalid pkt size: %u off: %u total: %u",
+				pkt_words, size_processed, read_len);
+			rc = -EINVAL;
+			break;
+		}
+
+		msg_processed_len = 0;
+		cam_icp_process_msg_pkt_type(hw_mgr, msg_ptr,
+			&msg_processed_len);
+
+		if (!msg_processed_len) {
+			CAM_ERR(CAM_ICP, "Failed to read");
+			rc = -EINVAL;
+			break;
+		}
+
+		size_processed += (msg_processed_len >> BYTE_WORD_SHIFT);
+	}
+
+	return rc;
+}
+
 static int32_t cam_icp_mgr_process_msg(void *priv, void *data)
 {
-	uint32_t read_len, msg_processed_len;
-	uint32_t *msg_ptr = NULL;
 	struct hfi_msg_work_data *task_data;
 	struct cam_icp_hw_mgr *hw_mgr;
-	int rc = 0;
+	uint32_t read_len;
+	int i, rc = 0;
 
 	if (!data || !priv) {
 		CAM_ERR(CAM_ICP, "Invalid data");
@@ -2692,31 +2765,26 @@ static int32_t cam_icp_mgr_process_msg(void *priv, void *data)
 	task_data = data;
 	hw_mgr = priv;
 
-	rc = hfi_read_message(icp_hw_mgr.msg_buf, Q_MSG, &read_len);
-	if (rc) {
-		CAM_DBG(CAM_ICP, "Unable to read msg q rc %d", rc);
-	} else {
-		read_len = read_len << BYTE_WORD_SHIFT;
-		msg_ptr = (uint32_t *)icp_hw_mgr.msg_buf;
-		while (true) {
-			cam_icp_process_msg_pkt_type(hw_mgr, msg_ptr,
-				&msg_processed_len);
-
-			if (!msg_processed_len) {
-				CAM_ERR(CAM_ICP, "Failed to read");
-				rc = -EINVAL;
-				break;
-			}
-
-			read_len -= msg_processed_len;
-			if (read_len > 0) {
-				msg_ptr += (msg_processed_len >>
-				BYTE_WORD_SHIFT);
-				msg_processed_len = 0;
-			} else {
-				break;
-			}
+	/*
+	 * Keep draining while firmware posts more, so back to back acks are
+	 * handled in one pass instead of waiting for the next interrupt's
+	 * work item. Messages are copied out so that handlers, which may
+	 * read the debug queue during recovery, run without the queue lock.
+	 */
+	for (i = 0; i < ICP_MSG_Q_MAX_DRAIN; i++) {
+		rc = hfi_read_message(hw_mgr->msg_buf, Q_MSG, &read_len);
+		if (rc) {
+			if (!i)
+				CAM_DBG(CAM_ICP, "Unable to read msg q rc %d",
+					rc);
+			rc = 0;
+			break;
 		}
+
+		rc = cam_icp_mgr_process_msg_buf(hw_mgr, hw_mgr->msg_buf,
+			read_len);
+		if (rc)
+			break;
 	}
 
 	cam_icp_mgr_process_dbg_buf(icp_hw_mgr.icp_dbg_lvl);
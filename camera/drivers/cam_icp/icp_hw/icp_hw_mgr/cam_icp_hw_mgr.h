@@ -16,6 +16,7 @@
 #include "cam_a5_hw_intf.h"
 #include "hfi_session_defs.h"
 #include "hfi_intf.h"
+#include "hfi_reg.h"
 #include "cam_req_mgr_workq.h"
 #include "cam_mem_mgr.h"
 #include "cam_smmu_api.h"
@@ -41,8 +42,9 @@
 
 #define ICP_FRAME_PROCESS_SUCCESS 0
 #define ICP_FRAME_PROCESS_FAILURE 1
-#define ICP_MSG_BUF_SIZE        256
+#define ICP_MSG_BUF_SIZE        ICP_HFI_MAX_PKT_SIZE_MSGQ_IN_WORDS
 #define ICP_DBG_BUF_SIZE        102400
+#define ICP_MSG_Q_MAX_DRAIN     8
 
 #define ICP_CLK_HW_IPE          0x0
 #define ICP_CLK_HW_BPS          0x1
@@ -341,7 +343,7 @@ struct cam_icp_clk_info {
  * @msg_work: Work queue for hfi messages
  * @timer_work: Work queue for timer watchdog
  * @msg_buf: Buffer for message data from firmware
- * @dbg_buf: Buffer for debug data from firmware
+ * @dbg_buf: Bounce buffer for packets wrapping around the debug queue
  * @icp_complete: Completion info
  * @cmd_work_data: Pointer to command work queue task
  * @msg_work_data: Pointer to message work queue task
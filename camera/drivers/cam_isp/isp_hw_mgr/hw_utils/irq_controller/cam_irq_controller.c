@@ -7,12 +7,20 @@
 #include <linux/spinlock_types.h>
 #include <linux/list.h>
 #include <linux/ratelimit.h>
+#include <linux/hashtable.h>
+#include <linux/bitops.h>
 
 #include "cam_io_util.h"
 #include "cam_irq_controller.h"
 #include "cam_debug_util.h"
 #include "cam_common_util.h"
 
+/* Handlers beyond this count fall back to a list walk in top half */
+#define CAM_IRQ_MAX_INDEXED_HANDLERS 64
+
+#define CAM_IRQ_HANDLE_HASH_BITS     5
+#define CAM_IRQ_BITS_PER_REG         32
+
 /**
  * struct cam_irq_evt_handler:
  * @Brief:                  Event handler information
@@ -30,8 +38,11 @@
  *                          Function used to enqueue the bottom_half event
  * @list_node:              list_head struct used for overall handler List
  * @th_list_node:           list_head struct used for top half handler List
+ * @hash_node:              hlist_node used for handle lookup hash
  * @index:                  Unique id of the event
  * @group:                  Group to which the event belongs
+ * @th_slot:                Slot of this handler in the top half bit index,
+ *                          negative if the handler is not indexed
  */
 struct cam_irq_evt_handler {
 	enum cam_irq_priority_level        priority;
@@ -43,8 +54,10 @@ struct cam_irq_evt_handler {
 	struct cam_irq_bh_api              irq_bh_api;
 	struct list_head                   list_node;
 	struct list_head                   th_list_node;
+	struct hlist_node                  hash_node;
 	int                                index;
 	int                                group;
+	int                                th_slot;
 };
 
 /**
@@ -100,6 +113,13 @@ struct cam_irq_register_obj {
  * @dependent_controller:   Array of controllers that depend on this controller
  * @delayed_global_clear:   Flag to indicate if this controller issues global clear after dependent
  *                          controllers are handled
+ * @evt_handler_hash:       Hash of event handlers keyed by handle
+ * @bit_subscribers:        Bitmap of handler slots per (register, bit), used by
+ *                          top half to visit only handlers whose bits are set
+ * @th_prio_slots:          Bitmap of top half slots in use per priority, slots
+ *                          of a priority ascend in subscription order
+ * @th_slot_handler:        Handler owning each top half slot
+ * @th_num_unindexed:       Number of handlers per priority without a slot
  * @lock:                   Lock to be used by controller, Use mutex lock in presil mode,
  *                          and spinlock in regular case
  */
@@ -119,6 +139,11 @@ struct cam_irq_controller {
 	bool                            is_dependent;
 	struct cam_irq_controller      *dependent_controller[CAM_IRQ_MAX_DEPENDENTS];
 	bool                            delayed_global_clear;
+	DECLARE_HASHTABLE(evt_handler_hash, CAM_IRQ_HANDLE_HASH_BITS);
+	uint64_t                       *bit_subscribers;
+	uint64_t                        th_prio_slots[CAM_IRQ_PRIORITY_MAX];
+	struct cam_irq_evt_handler     *th_slot_handler[CAM_IRQ_MAX_INDEXED_HANDLERS];
+	uint32_t                        th_num_unindexed[CAM_IRQ_PRIORITY_MAX];
 
 #ifdef CONFIG_CAM_PRESIL
 	struct mutex                    lock;
@@ -318,6 +343,7 @@ int cam_irq_controller_deinit(void **irq_controller)
 		kfree(evt_handler);
 	}
 
+	kfree(controller->bit_subscribers);
 	kfree(controller->th_payload.evt_status_arr);
 	kfree(controller->irq_status_arr);
 	kfree(controller->irq_register_arr);
@@ -375,6 +401,14 @@ int cam_irq_controller_init(const char       *name,
 		goto evt_mask_alloc_error;
 	}
 
+	controller->bit_subscribers = kcalloc(register_info->num_registers *
+		CAM_IRQ_BITS_PER_REG, sizeof(uint64_t), GFP_KERNEL);
+	if (!controller->bit_subscribers) {
+		CAM_DBG(CAM_IRQ_CTRL, "Failed to allocate IRQ bit index");
+		rc = -ENOMEM;
+		goto bit_index_alloc_error;
+	}
+
 	controller->name = name;
 
 	CAM_DBG(CAM_IRQ_CTRL, "num_registers: %d",
@@ -411,6 +445,7 @@ int cam_irq_controller_init(const char       *name,
 	INIT_LIST_HEAD(&controller->evt_handler_list_head);
 	for (i = 0; i < CAM_IRQ_PRIORITY_MAX; i++)
 		INIT_LIST_HEAD(&controller->th_list_head[i]);
+	hash_init(controller->evt_handler_hash);
 
 	cam_irq_controller_lock_init(controller);
 
@@ -419,6 +454,8 @@ int cam_irq_controller_init(const char       *name,
 
 	return rc;
 
+bit_index_alloc_error:
+	kfree(controller->th_payload.evt_status_arr);
 evt_mask_alloc_error:
 	kfree(controller->irq_status_arr);
 status_alloc_error:
@@ -429,6 +466,133 @@ reg_alloc_error:
 	return rc;
 }
 
+static void cam_irq_controller_update_bit_index(
+	struct cam_irq_controller  *controller,
+	struct cam_irq_evt_handler *evt_handler,
+	bool                        add)
+{
+	uint64_t *subscribers;
+	unsigned long mask;
+	int i, bit;
+
+	if (evt_handler->th_slot < 0)
+		return;
+
+	for (i = 0; i < controller->num_registers; i++) {
+		subscribers = &controller->bit_subscribers[
+			i * CAM_IRQ_BITS_PER_REG];
+		mask = evt_handler->evt_bit_mask_arr[i];
+		for_each_set_bit(bit, &mask, CAM_IRQ_BITS_PER_REG) {
+			if (add)
+				subscribers[bit] |= BIT_ULL(evt_handler->th_slot);
+			else
+				subscribers[bit] &= ~BIT_ULL(evt_handler->th_slot);
+		}
+	}
+}
+
+static void cam_irq_controller_assign_slot(
+	struct cam_irq_controller  *controller,
+	struct cam_irq_evt_handler *evt_handler,
+	int                         slot)
+{
+	evt_handler->th_slot = slot;
+	controller->th_slot_handler[slot] = evt_handler;
+	controller->th_prio_slots[evt_handler->priority] |= BIT_ULL(slot);
+	cam_irq_controller_update_bit_index(controller, evt_handler, true);
+}
+
+/*
+ * Hand out slots again in subscription order, priority by priority, so the
+ * slots of each priority ascend in list order. Handlers beyond the slot
+ * count stay unindexed.
+ */
+static void cam_irq_controller_rebuild_index(
+	struct cam_irq_controller  *controller)
+{
+	struct cam_irq_evt_handler *evt_handler;
+	int i, slot = 0;
+
+	memset(controller->bit_subscribers, 0, controller->num_registers *
+		CAM_IRQ_BITS_PER_REG * sizeof(uint64_t));
+	memset(controller->th_prio_slots, 0,
+		sizeof(controller->th_prio_slots));
+	memset(controller->th_slot_handler, 0,
+		sizeof(controller->th_slot_handler));
+	memset(controller->th_num_unindexed, 0,
+		sizeof(controller->th_num_unindexed));
+
+	for (i = 0; i < CAM_IRQ_PRIORITY_MAX; i++) {
+		list_for_each_entry(evt_handler, &controller->th_list_head[i],
+			th_list_node) {
+			if (slot < CAM_IRQ_MAX_INDEXED_HANDLERS) {
+				cam_irq_controller_assign_slot(controller,
+					evt_handler, slot++);
+			} else {
+				evt_handler->th_slot = -1;
+				controller->th_num_unindexed[i]++;
+			}
+		}
+	}
+}
+
+/* Called after evt_handler was added to the tail of its th_list */
+static void cam_irq_controller_add_to_index(
+	struct cam_irq_controller  *controller,
+	struct cam_irq_evt_handler *evt_handler)
+{
+	uint64_t used_slots = 0, free_slots;
+	uint64_t prio_slots;
+	int i;
+
+	hash_add(controller->evt_handler_hash, &evt_handler->hash_node,
+		evt_handler->index);
+
+	evt_handler->th_slot = -1;
+	if (controller->th_num_unindexed[evt_handler->priority]) {
+		controller->th_num_unindexed[evt_handler->priority]++;
+		return;
+	}
+
+	for (i = 0; i < CAM_IRQ_PRIORITY_MAX; i++)
+		used_slots |= controller->th_prio_slots[i];
+
+	/* Keep subscription order, the slot must be above the priority's last */
+	free_slots = ~used_slots;
+	prio_slots = controller->th_prio_slots[evt_handler->priority];
+	if (prio_slots)
+		free_slots &= ~GENMASK_ULL(fls64(prio_slots) - 1, 0);
+
+	if (free_slots) {
+		cam_irq_controller_assign_slot(controller, evt_handler,
+			__ffs64(free_slots));
+		return;
+	}
+
+	cam_irq_controller_rebuild_index(controller);
+	if (evt_handler->th_slot < 0)
+		CAM_DBG(CAM_IRQ_CTRL, "(%s) no free slot for handle %d",
+			controller->name, evt_handler->index);
+}
+
+static void cam_irq_controller_remove_from_index(
+	struct cam_irq_controller  *controller,
+	struct cam_irq_evt_handler *evt_handler)
+{
+	hash_del(&evt_handler->hash_node);
+
+	if (evt_handler->th_slot < 0) {
+		controller->th_num_unindexed[evt_handler->priority]--;
+		return;
+	}
+
+	cam_irq_controller_update_bit_index(controller, evt_handler, false);
+	controller->th_prio_slots[evt_handler->priority] &=
+		~BIT_ULL(evt_handler->th_slot);
+	controller->th_slot_handler[evt_handler->th_slot] = NULL;
+	evt_handler->th_slot = -1;
+}
+
 static inline void __cam_irq_controller_disable_irq(
 	struct cam_irq_controller  *controller,
 	struct cam_irq_evt_handler *evt_handler)
@@ -541,6 +705,7 @@ int cam_irq_controller_subscribe_irq(void *irq_controller,
 
 	INIT_LIST_HEAD(&evt_handler->list_node);
 	INIT_LIST_HEAD(&evt_handler->th_list_node);
+	INIT_HLIST_NODE(&evt_handler->hash_node);
 
 	for (i = 0; i < controller->num_registers; i++)
 		evt_handler->evt_bit_mask_arr[i] = evt_bit_mask_arr[i];
@@ -568,6 +733,7 @@ int cam_irq_controller_subscribe_irq(void *irq_controller,
 		&controller->evt_handler_list_head);
 	list_add_tail(&evt_handler->th_list_node,
 		&controller->th_list_head[priority]);
+	cam_irq_controller_add_to_index(controller, evt_handler);
 
 	cam_irq_controller_unlock_irqrestore(controller, flags);
 
@@ -583,11 +749,11 @@ free_evt_handler:
 static inline int cam_irq_controller_find_event_handle(struct cam_irq_controller *controller,
 	uint32_t handle, struct cam_irq_evt_handler **found_evt_handler)
 {
-	struct cam_irq_evt_handler  *evt_handler, *evt_handler_temp;
+	struct cam_irq_evt_handler  *evt_handler;
 	int rc = -EINVAL;
 
-	list_for_each_entry_safe(evt_handler, evt_handler_temp,
-		&controller->evt_handler_list_head, list_node) {
+	hash_for_each_possible(controller->evt_handler_hash, evt_handler,
+		hash_node, handle) {
 		if (evt_handler->index == handle) {
 			rc = 0;
 			*found_evt_handler = evt_handler;
@@ -669,6 +835,7 @@ int cam_irq_controller_unsubscribe_irq(void *irq_controller,
 
 	list_del_init(&evt_handler->list_node);
 	list_del_init(&evt_handler->th_list_node);
+	cam_irq_controller_remove_from_index(controller, evt_handler);
 
 	__cam_irq_controller_disable_irq(controller, evt_handler);
 	cam_irq_controller_clear_irq(controller, evt_handler);
@@ -714,83 +881,119 @@ static bool cam_irq_controller_match_bit_mask(
 	return false;
 }
 
-static void __cam_irq_controller_th_processing(
+static void __cam_irq_controller_th_dispatch(
 	struct cam_irq_controller      *controller,
-	struct list_head               *th_list_head,
-	int                             evt_grp)
+	struct cam_irq_evt_handler     *evt_handler)
 {
-	struct cam_irq_evt_handler     *evt_handler = NULL;
-	struct cam_irq_evt_handler     *evt_handler_tmp = NULL;
 	struct cam_irq_th_payload      *th_payload = &controller->th_payload;
-	bool                            is_irq_match;
 	int                             rc = -EINVAL;
 	int                             i;
 	void                           *bh_cmd = NULL;
 	struct cam_irq_bh_api          *irq_bh_api = NULL;
 
-	CAM_DBG(CAM_IRQ_CTRL, "Enter");
+	CAM_DBG(CAM_IRQ_CTRL, "match found");
 
-	if (list_empty(th_list_head))
+	cam_irq_th_payload_init(th_payload);
+	th_payload->handler_priv  = evt_handler->handler_priv;
+	th_payload->num_registers = controller->num_registers;
+	for (i = 0; i < controller->num_registers; i++) {
+		th_payload->evt_status_arr[i] =
+			controller->irq_status_arr[i] &
+			evt_handler->evt_bit_mask_arr[i];
+	}
+
+	irq_bh_api = &evt_handler->irq_bh_api;
+
+	if (evt_handler->bottom_half_handler) {
+		rc = irq_bh_api->get_bh_payload_func(
+			evt_handler->bottom_half, &bh_cmd);
+		if (rc || !bh_cmd) {
+			CAM_ERR_RATE_LIMIT(CAM_ISP,
+				"No payload, IRQ handling frozen for %s",
+				controller->name);
+			return;
+		}
+	}
+
+	/*
+	 * irq_status_arr[0] is dummy argument passed. the entire
+	 * status array is passed in th_payload.
+	 */
+	if (evt_handler->top_half_handler)
+		rc = evt_handler->top_half_handler(
+			controller->irq_status_arr[0],
+			(void *)th_payload);
+
+	if (rc && bh_cmd) {
+		irq_bh_api->put_bh_payload_func(
+			evt_handler->bottom_half, &bh_cmd);
 		return;
+	}
+
+	if (evt_handler->bottom_half_handler) {
+		CAM_DBG(CAM_IRQ_CTRL, "Enqueuing bottom half for %s",
+			controller->name);
+		irq_bh_api->bottom_half_enqueue_func(
+			evt_handler->bottom_half,
+			bh_cmd,
+			evt_handler->handler_priv,
+			th_payload->evt_payload_priv,
+			evt_handler->bottom_half_handler);
+	}
+}
 
-	list_for_each_entry_safe(evt_handler, evt_handler_tmp, th_list_head, th_list_node) {
-		is_irq_match = cam_irq_controller_match_bit_mask(controller, evt_handler, evt_grp);
+static void __cam_irq_controller_th_processing(
+	struct cam_irq_controller      *controller,
+	int                             priority,
+	int                             evt_grp)
+{
+	struct cam_irq_evt_handler     *evt_handler = NULL;
+	struct cam_irq_evt_handler     *evt_handler_tmp = NULL;
+	struct list_head               *th_list_head;
+	uint64_t                        candidates = 0;
+	unsigned long                   status;
+	int                             i, bit, slot;
 
-		if (!is_irq_match)
-			continue;
+	CAM_DBG(CAM_IRQ_CTRL, "Enter");
 
-		CAM_DBG(CAM_IRQ_CTRL, "match found");
+	th_list_head = &controller->th_list_head[priority];
+	if (list_empty(th_list_head))
+		return;
 
-		cam_irq_th_payload_init(th_payload);
-		th_payload->handler_priv  = evt_handler->handler_priv;
-		th_payload->num_registers = controller->num_registers;
-		for (i = 0; i < controller->num_registers; i++) {
-			th_payload->evt_status_arr[i] =
-				controller->irq_status_arr[i] &
-				evt_handler->evt_bit_mask_arr[i];
+	/* Without a complete index keep the subscription order by list walk */
+	if (controller->th_num_unindexed[priority]) {
+		list_for_each_entry_safe(evt_handler, evt_handler_tmp,
+			th_list_head, th_list_node) {
+			if (cam_irq_controller_match_bit_mask(controller,
+				evt_handler, evt_grp))
+				__cam_irq_controller_th_dispatch(controller,
+					evt_handler);
 		}
+		goto end;
+	}
 
-		irq_bh_api = &evt_handler->irq_bh_api;
-		bh_cmd = NULL;
-
-		if (evt_handler->bottom_half_handler) {
-			rc = irq_bh_api->get_bh_payload_func(
-				evt_handler->bottom_half, &bh_cmd);
-			if (rc || !bh_cmd) {
-				CAM_ERR_RATE_LIMIT(CAM_ISP,
-					"No payload, IRQ handling frozen for %s",
-					controller->name);
-				continue;
-			}
-		}
+	/* Collect handlers subscribed to any of the bits that are set */
+	for (i = 0; i < controller->num_registers; i++) {
+		status = controller->irq_status_arr[i];
+		for_each_set_bit(bit, &status, CAM_IRQ_BITS_PER_REG)
+			candidates |= controller->bit_subscribers[
+				(i * CAM_IRQ_BITS_PER_REG) + bit];
+	}
+	candidates &= controller->th_prio_slots[priority];
+
+	/* Slots ascend in subscription order within a priority */
+	while (candidates) {
+		slot = __ffs64(candidates);
+		candidates &= ~BIT_ULL(slot);
 
-		/*
-		 * irq_status_arr[0] is dummy argument passed. the entire
-		 * status array is passed in th_payload.
-		 */
-		if (evt_handler->top_half_handler)
-			rc = evt_handler->top_half_handler(
-				controller->irq_status_arr[0],
-				(void *)th_payload);
-
-		if (rc && bh_cmd) {
-			irq_bh_api->put_bh_payload_func(
-				evt_handler->bottom_half, &bh_cmd);
+		evt_handler = controller->th_slot_handler[slot];
+		if (!evt_handler || (evt_handler->group != evt_grp))
 			continue;
-		}
 
-		if (evt_handler->bottom_half_handler) {
-			CAM_DBG(CAM_IRQ_CTRL, "Enqueuing bottom half for %s",
-				controller->name);
-			irq_bh_api->bottom_half_enqueue_func(
-				evt_handler->bottom_half,
-				bh_cmd,
-				evt_handler->handler_priv,
-				th_payload->evt_payload_priv,
-				evt_handler->bottom_half_handler);
-		}
+		__cam_irq_controller_th_dispatch(controller, evt_handler);
 	}
 
+end:
 	CAM_DBG(CAM_IRQ_CTRL, "Exit");
 }
 
@@ -913,8 +1116,7 @@ static void cam_irq_controller_process_th(struct cam_irq_controller *controller,
 		if (need_th_processing[i]) {
 			CAM_DBG(CAM_IRQ_CTRL, "(%s) Invoke TH processing priority:%d",
 				controller->name, i);
-			__cam_irq_controller_th_processing(controller, &controller->th_list_head[i],
-				evt_grp);
+			__cam_irq_controller_th_processing(controller, i, evt_grp);
 		}
 	}
 }
@@ -964,6 +1166,7 @@ int cam_irq_controller_update_irq(void *irq_controller, uint32_t handle,
 		goto end;
 
 	__cam_irq_controller_disable_irq(controller, evt_handler);
+	cam_irq_controller_update_bit_index(controller, evt_handler, false);
 	for (i = 0; i < controller->num_registers; i++) {
 		if (enable) {
 			evt_handler->evt_bit_mask_arr[i] |= irq_mask[i];
@@ -971,6 +1174,7 @@ int cam_irq_controller_update_irq(void *irq_controller, uint32_t handle,
 			evt_handler->evt_bit_mask_arr[i] &= ~irq_mask[i];
 		}
 	}
+	cam_irq_controller_update_bit_index(controller, evt_handler, true);
 	__cam_irq_controller_enable_irq(controller, evt_handler);
 	cam_irq_controller_clear_irq(controller, evt_handler);
 
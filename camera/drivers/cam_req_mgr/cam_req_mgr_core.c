@@ -1200,8 +1200,23 @@ static int32_t __cam_req_mgr_find_slot_for_req(
 	struct cam_req_mgr_req_queue *in_q, int64_t req_id)
 {
 	int32_t                   idx, i;
+	int64_t                   delta;
 	struct cam_req_mgr_slot  *slot;
 
+	/*
+	 * Requests are scheduled in increasing order into consecutive
+	 * slots, so the slot can usually be derived from its distance to
+	 * the last scheduled request. Fall back to a scan if the slot
+	 * does not hold the request, e.g. after a flush.
+	 */
+	delta = in_q->last_sched_req_id - req_id;
+	if ((req_id >= 0) && (delta >= 0) && (delta < in_q->num_slots)) {
+		idx = in_q->last_sched_idx;
+		__cam_req_mgr_dec_idx(&idx, (int32_t)delta, in_q->num_slots);
+		if (in_q->slot[idx].req_id == req_id)
+			return idx;
+	}
+
 	idx = in_q->rd_idx;
 	for (i = 0; i < in_q->num_slots; i++) {
 		slot = &in_q->slot[idx];
@@ -1795,6 +1810,7 @@ static int __cam_req_mgr_process_req(struct cam_req_mgr_core_link *link,
 	struct cam_req_mgr_core_link        *tmp_link = NULL;
 	uint32_t                             max_retry = 0;
 	enum crm_req_eof_trigger_type        eof_trigger_type;
+	ktime_t                              decision_start;
 
 	session = (struct cam_req_mgr_core_session *)link->parent;
 	if (!session) {
@@ -1872,6 +1888,7 @@ static int __cam_req_mgr_process_req(struct cam_req_mgr_core_link *link,
 	}
 
 	if (slot->status != CRM_SLOT_STATUS_REQ_READY) {
+		decision_start = ktime_get();
 		if (slot->sync_mode == CAM_REQ_MGR_SYNC_MODE_SYNC) {
 			rc = __cam_req_mgr_check_multi_sync_link_ready(
 				link, slot, trigger);
@@ -1921,6 +1938,9 @@ static int __cam_req_mgr_process_req(struct cam_req_mgr_core_link *link,
 			}
 		}
 
+		trace_cam_req_mgr_apply_decision(link, slot->req_id, trigger,
+			rc, ktime_to_ns(ktime_sub(ktime_get(), decision_start)));
+
 		if (rc < 0) {
 			/*
 			 * If traverse result is not success, then some devices
@@ -2810,6 +2830,8 @@ int cam_req_mgr_process_sched_req(void *priv, void *data)
 	CAM_DBG(CAM_REQ, "Open_req_cnt: %u after scheduling req: %d",
 		link->open_req_cnt,
 		sched_req->req_id);
+	in_q->last_sched_req_id = slot->req_id;
+	in_q->last_sched_idx = in_q->wr_idx;
 	__cam_req_mgr_inc_idx(&in_q->wr_idx, 1, in_q->num_slots);
 
 	if (slot->sync_mode == CAM_REQ_MGR_SYNC_MODE_SYNC) {
@@ -289,6 +289,8 @@ struct cam_req_mgr_slot {
  * @rd_idx      : indicates slot index currently in process.
  * @wr_idx      : indicates slot index to hold new upcoming req.
  * @last_applied_idx : indicates slot index last applied successfully.
+ * @last_sched_req_id: req id scheduled most recently, lookup hint
+ * @last_sched_idx   : slot index holding last_sched_req_id
  */
 struct cam_req_mgr_req_queue {
 	int32_t                     num_slots;
@@ -296,6 +298,8 @@ struct cam_req_mgr_req_queue {
 	int32_t                     rd_idx;
 	int32_t                     wr_idx;
 	int32_t                     last_applied_idx;
+	int64_t                     last_sched_req_id;
+	int32_t                     last_sched_idx;
 };
 
 /**
@@ -7,6 +7,7 @@
 #include "cam_req_mgr_workq.h"
 #include "cam_debug_util.h"
 #include "cam_common_util.h"
+#include "cam_trace.h"
 
 #define WORKQ_ACQUIRE_LOCK(workq, flags) {\
 	if ((workq)->in_irq) \
@@ -32,8 +33,15 @@ struct crm_workq_task *cam_req_mgr_workq_get_task(
 		return NULL;
 
 	WORKQ_ACQUIRE_LOCK(workq, flags);
-	if (list_empty(&workq->task.empty_head))
+	if (list_empty(&workq->task.empty_head)) {
+		atomic_inc(&workq->task.overflow_cnt);
+		CAM_WARN_RATE_LIMIT(CAM_CRM,
+			"%s out of tasks, pending %d overflow_cnt %d",
+			workq->workq_name,
+			atomic_read(&workq->task.pending_cnt),
+			atomic_read(&workq->task.overflow_cnt));
 		goto end;
+	}
 
 	task = list_first_entry(&workq->task.empty_head,
 		struct crm_workq_task, entry);
@@ -48,6 +56,15 @@ end:
 	return task;
 }
 
+/* Caller must hold workq->lock_bh */
+static void __cam_req_mgr_workq_put_task(
+	struct cam_req_mgr_core_workq *workq, struct crm_workq_task *task)
+{
+	list_add_tail(&task->entry,
+		&workq->task.empty_head);
+	atomic_add(1, &workq->task.free_cnt);
+}
+
 static void cam_req_mgr_workq_put_task(struct crm_workq_task *task)
 {
 	struct cam_req_mgr_core_workq *workq =
@@ -59,12 +76,54 @@ static void cam_req_mgr_workq_put_task(struct crm_workq_task *task)
 	task->process_cb = NULL;
 	task->priv = NULL;
 	WORKQ_ACQUIRE_LOCK(workq, flags);
-	list_add_tail(&task->entry,
-		&workq->task.empty_head);
-	atomic_add(1, &workq->task.free_cnt);
+	__cam_req_mgr_workq_put_task(workq, task);
 	WORKQ_RELEASE_LOCK(workq, flags);
 }
 
+/*
+ * Caller must hold workq->lock_bh. Lanes are strictly ordered, a task
+ * on a higher priority lane is always picked first even if it was
+ * enqueued while lower priority tasks were being drained.
+ */
+static struct crm_workq_task *__cam_req_mgr_workq_dequeue_task(
+	struct cam_req_mgr_core_workq *workq)
+{
+	struct crm_workq_task *task;
+	int32_t i;
+
+	for (i = CRM_TASK_PRIORITY_0; i < CRM_TASK_PRIORITY_MAX; i++) {
+		if (list_empty(&workq->task.process_head[i]))
+			continue;
+
+		task = list_first_entry(&workq->task.process_head[i],
+			struct crm_workq_task, entry);
+		atomic_sub(1, &workq->task.pending_cnt);
+		list_del_init(&task->entry);
+		return task;
+	}
+
+	return NULL;
+}
+
+static void cam_req_mgr_workq_track_latency(
+	struct cam_req_mgr_core_workq *workq, struct crm_workq_task *task)
+{
+	int64_t latency_us;
+
+	latency_us = ktime_us_delta(ktime_get(), task->enqueue_ts);
+	trace_cam_workq_task(workq->workq_name, task->priority, latency_us,
+		atomic_read(&workq->task.pending_cnt));
+
+	if (latency_us <= workq->task.max_latency_us)
+		return;
+
+	workq->task.max_latency_us = latency_us;
+	if (latency_us > CAM_WORKQ_TASK_LATENCY_THRESHOLD_US)
+		CAM_WARN_RATE_LIMIT(CAM_CRM,
+			"%s task prio %d waited %lld us",
+			workq->workq_name, task->priority, latency_us);
+}
+
 void cam_req_mgr_workq_flush(struct cam_req_mgr_core_workq *workq)
 {
 	if (!workq) {
@@ -80,20 +139,18 @@ void cam_req_mgr_workq_flush(struct cam_req_mgr_core_workq *workq)
 /**
  * cam_req_mgr_process_task() - Process the enqueued task
  * @task: pointer to task workq thread shall process
+ *
+ * Task is returned to the free pool by the caller.
  */
 static int cam_req_mgr_process_task(struct crm_workq_task *task)
 {
-	struct cam_req_mgr_core_workq *workq = NULL;
-
 	if (!task)
 		return -EINVAL;
 
-	workq = (struct cam_req_mgr_core_workq *)task->parent;
 	if (task->process_cb)
 		task->process_cb(task->priv, task->payload);
 	else
 		CAM_WARN(CAM_CRM, "FATAL:no task handler registered for workq");
-	cam_req_mgr_workq_put_task(task);
 
 	return 0;
 }
@@ -106,7 +163,6 @@ void cam_req_mgr_process_workq(struct work_struct *w)
 {
 	struct cam_req_mgr_core_workq *workq = NULL;
 	struct crm_workq_task         *task;
-	int32_t                        i = CRM_TASK_PRIORITY_0;
 	unsigned long                  flags = 0;
 	ktime_t                        sched_start_time;
 
@@ -122,23 +178,26 @@ void cam_req_mgr_process_workq(struct work_struct *w)
 		workq->workq_scheduled_ts,
 		CAM_WORKQ_SCHEDULE_TIME_THRESHOLD);
 	sched_start_time = ktime_get();
-	while (i < CRM_TASK_PRIORITY_MAX) {
-		WORKQ_ACQUIRE_LOCK(workq, flags);
-		while (!list_empty(&workq->task.process_head[i])) {
-			task = list_first_entry(&workq->task.process_head[i],
-				struct crm_workq_task, entry);
-			atomic_sub(1, &workq->task.pending_cnt);
-			list_del_init(&task->entry);
-			WORKQ_RELEASE_LOCK(workq, flags);
-			if (!unlikely(atomic_read(&workq->flush)))
-				cam_req_mgr_process_task(task);
-			CAM_DBG(CAM_CRM, "processed task %pK free_cnt %d",
-				task, atomic_read(&workq->task.free_cnt));
-			WORKQ_ACQUIRE_LOCK(workq, flags);
-		}
+
+	/*
+	 * Returning a finished task to the pool and picking the next one
+	 * share a single lock acquisition.
+	 */
+	WORKQ_ACQUIRE_LOCK(workq, flags);
+	while ((task = __cam_req_mgr_workq_dequeue_task(workq))) {
 		WORKQ_RELEASE_LOCK(workq, flags);
-		i++;
+		cam_req_mgr_workq_track_latency(workq, task);
+		if (!unlikely(atomic_read(&workq->flush)))
+			cam_req_mgr_process_task(task);
+		CAM_DBG(CAM_CRM, "processed task %pK free_cnt %d",
+			task, atomic_read(&workq->task.free_cnt));
+		task->cancel = 0;
+		task->process_cb = NULL;
+		task->priv = NULL;
+		WORKQ_ACQUIRE_LOCK(workq, flags);
+		__cam_req_mgr_workq_put_task(workq, task);
 	}
+	WORKQ_RELEASE_LOCK(workq, flags);
 	cam_common_util_thread_switch_delay_detect(
 		"CRM workq execution",
 		sched_start_time,
@@ -178,14 +237,18 @@ int cam_req_mgr_workq_enqueue_task(struct crm_workq_task *task,
 		goto abort;
 	}
 
+	task->enqueue_ts = ktime_get();
 	list_add_tail(&task->entry,
 		&workq->task.process_head[task->priority]);
 
 	atomic_add(1, &workq->task.pending_cnt);
+	if (atomic_read(&workq->task.pending_cnt) > workq->task.max_pending)
+		workq->task.max_pending =
+			atomic_read(&workq->task.pending_cnt);
 	CAM_DBG(CAM_CRM, "enq task %pK pending_cnt %d",
 		task, atomic_read(&workq->task.pending_cnt));
 
-	workq->workq_scheduled_ts = ktime_get();
+	workq->workq_scheduled_ts = task->enqueue_ts;
 	queue_work(workq->job, &workq->work);
 	WORKQ_RELEASE_LOCK(workq, flags);
 
@@ -237,6 +300,7 @@ int cam_req_mgr_workq_create(char *name, int32_t num_tasks,
 		/* Task attributes initialization */
 		atomic_set(&crm_workq->task.pending_cnt, 0);
 		atomic_set(&crm_workq->task.free_cnt, 0);
+		atomic_set(&crm_workq->task.overflow_cnt, 0);
 		for (i = CRM_TASK_PRIORITY_0; i < CRM_TASK_PRIORITY_MAX; i++)
 			INIT_LIST_HEAD(&crm_workq->task.process_head[i]);
 		INIT_LIST_HEAD(&crm_workq->task.empty_head);
@@ -277,7 +341,11 @@ void cam_req_mgr_workq_destroy(struct cam_req_mgr_core_workq **crm_workq)
 
 	if (crm_workq && *crm_workq) {
 		workq = *crm_workq;
-		CAM_DBG(CAM_CRM, "destroy workque %s", workq->workq_name);
+		CAM_DBG(CAM_CRM,
+			"destroy workque %s overflow_cnt %d max_pending %u max_latency %lld us",
+			workq->workq_name,
+			atomic_read(&workq->task.overflow_cnt),
+			workq->task.max_pending, workq->task.max_latency_us);
 		WORKQ_ACQUIRE_LOCK(workq, flags);
 		/* prevent any processing of callbacks */
 		atomic_set(&workq->flush, 1);
@@ -20,6 +20,9 @@
 /* Threshold for execution delay in ms */
 #define CAM_WORKQ_EXE_TIME_THRESHOLD        10
 
+/* Threshold for task enqueue to execution latency in us */
+#define CAM_WORKQ_TASK_LATENCY_THRESHOLD_US 2000
+
 /* Flag to create a high priority workq */
 #define CAM_WORKQ_FLAG_HIGH_PRIORITY             (1 << 0)
 
@@ -56,6 +59,7 @@ enum crm_workq_context {
  * @priv       : when task is enqueuer caller can attach priv along which
  *               it will get in process callback
  * @ret        : return value in future to use for blocking calls
+ * @enqueue_ts : time at which task was enqueued, used for latency tracking
  */
 struct crm_workq_task {
 	int32_t                    priority;
@@ -66,6 +70,7 @@ struct crm_workq_task {
 	uint8_t                    cancel;
 	void                      *priv;
 	int32_t                    ret;
+	ktime_t                    enqueue_ts;
 };
 
 /** struct cam_req_mgr_core_workq
@@ -85,6 +90,9 @@ struct crm_workq_task {
  *                or acquired in order to enqueue a task to workq
  * @pool        : pool of tasks used for handling events in workq context
  * @num_task    : size of tasks pool
+ * @overflow_cnt: # of times a task was requested with the pool empty
+ * @max_pending : high watermark of pending tasks
+ * @max_latency_us: worst enqueue to execution latency seen
  */
 struct cam_req_mgr_core_workq {
 	struct work_struct         work;
@@ -105,6 +113,9 @@ struct cam_req_mgr_core_workq {
 		struct list_head       empty_head;
 		struct crm_workq_task *pool;
 		uint32_t               num_task;
+		atomic_t               overflow_cnt;
+		uint32_t               max_pending;
+		int64_t                max_latency_us;
 	} task;
 };
 
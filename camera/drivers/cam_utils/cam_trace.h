@@ -262,6 +262,31 @@ TRACE_EVENT(cam_req_mgr_apply_request,
 	)
 );
 
+TRACE_EVENT(cam_req_mgr_apply_decision,
+	TP_PROTO(struct cam_req_mgr_core_link *link, int64_t req_id,
+		uint32_t trigger, int rc, int64_t latency_ns),
+	TP_ARGS(link, req_id, trigger, rc, latency_ns),
+	TP_STRUCT__entry(
+		__field(int32_t, link_hdl)
+		__field(int64_t, req_id)
+		__field(uint32_t, trigger)
+		__field(int32_t, rc)
+		__field(int64_t, latency_ns)
+	),
+	TP_fast_assign(
+		__entry->link_hdl   = link->link_hdl;
+		__entry->req_id     = req_id;
+		__entry->trigger    = trigger;
+		__entry->rc         = rc;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk(
+		"ReqMgr ApplyDecision link_hdl=0x%x request=%lld trigger=%u %s latency=%lldns",
+			__entry->link_hdl, __entry->req_id, __entry->trigger,
+			__entry->rc ? "skip" : "apply", __entry->latency_ns
+	)
+);
+
 TRACE_EVENT(cam_req_mgr_add_req,
 	TP_PROTO(struct cam_req_mgr_core_link *link,
 		int idx, struct cam_req_mgr_add_request *add_req,
@@ -402,6 +427,29 @@ TRACE_EVENT(cam_cdm_cb,
 	)
 );
 
+TRACE_EVENT(cam_workq_task,
+	TP_PROTO(const char *entity, int32_t priority,
+		int64_t latency_us, uint32_t pending),
+	TP_ARGS(entity, priority, latency_us, pending),
+	TP_STRUCT__entry(
+		__string(entity, entity)
+		__field(int32_t, priority)
+		__field(int64_t, latency_us)
+		__field(uint32_t, pending)
+	),
+	TP_fast_assign(
+		__assign_str(entity, entity);
+		__entry->priority   = priority;
+		__entry->latency_us = latency_us;
+		__entry->pending    = pending;
+	),
+	TP_printk(
+		"%s: task prio=%d enq_to_exec=%lldus pending=%u",
+			__get_str(entity), __entry->priority,
+			__entry->latency_us, __entry->pending
+	)
+);
+
 #endif /* _CAM_TRACE_H */
 
 /* This part must be outside protection */
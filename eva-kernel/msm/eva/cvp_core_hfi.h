@@ -263,6 +263,8 @@ struct iris_hfi_device {
 	u8 *raw_packet;
 	struct pm_qos_request qos;
 	unsigned int skip_pc_count;
+	/* jiffies of the last queue activity, defers power collapse */
+	unsigned long last_activity;
 	struct msm_cvp_capability *sys_init_capabilities;
 	struct iris_hfi_vpu_ops *vpu_ops;
 };
@@ -1136,6 +1136,23 @@ exit:
 	return rc;
 }
 
+/*
+ * Records queue activity and makes sure the power collapse work is
+ * pending. The work itself defers until the device has been idle for the
+ * collapse delay, so a pending work is not cancelled and re-queued here.
+ */
+static void __schedule_power_collapse(struct iris_hfi_device *device)
+{
+	if (!device->res->sw_power_collapsible)
+		return;
+
+	WRITE_ONCE(device->last_activity, jiffies);
+	if (!queue_delayed_work(device->iris_pm_workq, &iris_hfi_pm_work,
+			msecs_to_jiffies(
+			device->res->msm_cvp_pwr_collapse_delay)))
+		dprintk(CVP_PWR, "PM work already scheduled\n");
+}
+
 /* Writes into cmdq without raising an interrupt */
 static int __iface_cmdq_write_relaxed(struct iris_hfi_device *device,
 		void *pkt, bool *requires_interrupt)
@@ -1178,17 +1195,7 @@ static int __iface_cmdq_write_relaxed(struct iris_hfi_device *device,
 	}
 
 	if (!__write_queue(q_info, (u8 *)pkt, requires_interrupt)) {
-		if (device->res->sw_power_collapsible) {
-			cancel_delayed_work(&iris_hfi_pm_work);
-			if (!queue_delayed_work(device->iris_pm_workq,
-				&iris_hfi_pm_work,
-				msecs_to_jiffies(
-				device->res->msm_cvp_pwr_collapse_delay))) {
-				dprintk(CVP_PWR,
-				"PM work already scheduled\n");
-			}
-		}
-
+		__schedule_power_collapse(device);
 		result = 0;
 	} else {
 		dprintk(CVP_ERR, "__iface_cmdq_write: queue full\n");
@@ -2487,6 +2494,25 @@ static void iris_hfi_pm_handler(struct work_struct *work)
 
 	dprintk(CVP_PWR,
 		"Entering %s\n", __func__);
+
+	/*
+	 * Queue activity only stamps last_activity instead of re-arming the
+	 * work, so push the collapse out until the device has been idle for
+	 * the full delay.
+	 */
+	if (gfa_cv.state != DSP_SUSPEND) {
+		unsigned long now = jiffies;
+		unsigned long idle_at = READ_ONCE(device->last_activity) +
+			msecs_to_jiffies(
+			device->res->msm_cvp_pwr_collapse_delay);
+
+		if (time_before(now, idle_at)) {
+			queue_delayed_work(device->iris_pm_workq,
+				&iris_hfi_pm_work, idle_at - now);
+			return;
+		}
+	}
+
 	/*
 	 * It is ok to check this variable outside the lock since
 	 * it is being updated in this context only
@@ -2951,15 +2977,8 @@ static int __response_handler(struct iris_hfi_device *device)
 			break;
 	}
 
-	if (requeue_pm_work && device->res->sw_power_collapsible) {
-		cancel_delayed_work(&iris_hfi_pm_work);
-		if (!queue_delayed_work(device->iris_pm_workq,
-			&iris_hfi_pm_work,
-			msecs_to_jiffies(
-				device->res->msm_cvp_pwr_collapse_delay))) {
-			dprintk(CVP_ERR, "PM work already scheduled\n");
-		}
-	}
+	if (requeue_pm_work)
+		__schedule_power_collapse(device);
 
 exit:
 	__flush_debug_queue(device, raw_packet);
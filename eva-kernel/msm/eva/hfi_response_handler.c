@@ -517,6 +517,9 @@ static int hfi_process_session_cvp_msg(u32 device_id,
 	}
 	list_add_tail(&sess_msg->node, &sq->msgs);
 	sq->msg_count++;
+	sq->msg_total++;
+	if (sq->msg_count > sq->max_msg_count)
+		sq->max_msg_count = sq->msg_count;
 	spin_unlock(&sq->lock);
 
 	wake_up_all(&sq->wq);
@@ -37,49 +37,38 @@ int msm_cvp_get_session_info(struct msm_cvp_inst *inst, u32 *session)
 
 
 
+/*
+ * Each session queue has a single consumer, the user receive path for
+ * session_queue and the fence done thread for session_queue_fence, so
+ * messages are always taken from the head. Fenced frames are matched to
+ * their response by ktid in the fence done thread.
+ */
 static bool cvp_msg_pending(struct cvp_session_queue *sq,
-				struct cvp_session_msg **msg, u64 *ktid)
+				struct cvp_session_msg **msg)
 {
-	struct cvp_session_msg *mptr, *dummy;
-	bool result = false;
+	struct cvp_session_msg *mptr = NULL;
 
-	mptr = NULL;
 	spin_lock(&sq->lock);
+	sq->wakeups++;
 	if (sq->state == QUEUE_INIT || sq->state == QUEUE_INVALID) {
 		/* The session is being deleted */
 		spin_unlock(&sq->lock);
 		*msg = NULL;
 		return true;
 	}
-	result = list_empty(&sq->msgs);
-	if (!result) {
-		if (!ktid) {
-			mptr =
-			list_first_entry(&sq->msgs, struct cvp_session_msg,
+	if (!list_empty(&sq->msgs)) {
+		mptr = list_first_entry(&sq->msgs, struct cvp_session_msg,
 					node);
-			list_del_init(&mptr->node);
-			sq->msg_count--;
-		} else {
-			result = true;
-			list_for_each_entry_safe(mptr, dummy, &sq->msgs, node) {
-				if (*ktid == mptr->pkt.client_data.kdata) {
-					list_del_init(&mptr->node);
-					sq->msg_count--;
-					result = false;
-					break;
-				}
-			}
-			if (result)
-				mptr = NULL;
-		}
+		list_del_init(&mptr->node);
+		sq->msg_count--;
 	}
 	spin_unlock(&sq->lock);
 	*msg = mptr;
-	return !result;
+	return mptr != NULL;
 }
 
 static int cvp_wait_process_message(struct msm_cvp_inst *inst,
-				struct cvp_session_queue *sq, u64 *ktid,
+				struct cvp_session_queue *sq,
 				unsigned long timeout,
 				struct eva_kmd_hfi_packet *out)
 {
@@ -88,7 +77,7 @@ static int cvp_wait_process_message(struct msm_cvp_inst *inst,
 	int rc = 0;
 
 	if (wait_event_timeout(sq->wq,
-		cvp_msg_pending(sq, &msg, ktid), timeout) == 0) {
+		cvp_msg_pending(sq, &msg), timeout) == 0) {
 		dprintk(CVP_WARN, "session queue wait timeout\n");
 		rc = -ETIMEDOUT;
 		goto exit;
@@ -144,7 +133,7 @@ static int msm_cvp_session_receive_hfi(struct msm_cvp_inst *inst,
 	wait_time = msecs_to_jiffies(CVP_MAX_WAIT_TIME);
 	sq = &inst->session_queue;
 
-	rc = cvp_wait_process_message(inst, sq, NULL, wait_time, out_pkt);
+	rc = cvp_wait_process_message(inst, sq, wait_time, out_pkt);
 
 	cvp_put_inst(inst);
 	return rc;
@@ -264,7 +253,7 @@ static bool cvp_fence_wait(struct cvp_fence_queue *q,
 		return true;
 	}
 
-	if (list_empty(&q->wait_list)) {
+	if (list_empty(&q->wait_list) || q->inflight >= q->depth) {
 		mutex_unlock(&q->lock);
 		return false;
 	}
@@ -272,6 +261,7 @@ static bool cvp_fence_wait(struct cvp_fence_queue *q,
 	f = list_first_entry(&q->wait_list, struct cvp_fence_command, list);
 	list_del_init(&f->list);
 	list_add_tail(&f->list, &q->sched_list);
+	q->inflight++;
 
 	mutex_unlock(&q->lock);
 	*fence = f;
@@ -446,25 +436,38 @@ static int cvp_check_clock(struct msm_cvp_inst *inst,
 	return rc;
 }
 
-static int cvp_fence_proc(struct msm_cvp_inst *inst,
+/*
+ * Lets the expiry path claim @fc. The response may already have retired
+ * and freed it, so @fc is only dereferenced if still on the sched list.
+ */
+static void cvp_fence_submit_done(struct cvp_fence_queue *q,
+			struct cvp_fence_command *fc)
+{
+	struct cvp_fence_command *f;
+
+	mutex_lock(&q->lock);
+	list_for_each_entry(f, &q->sched_list, list) {
+		if (f == fc) {
+			f->in_submit = false;
+			break;
+		}
+	}
+	mutex_unlock(&q->lock);
+}
+
+static int cvp_fence_submit(struct msm_cvp_inst *inst,
 			struct cvp_fence_command *fc,
 			struct cvp_hfi_cmd_session_hdr *pkt)
 {
 	int rc = 0;
-	unsigned long timeout;
-	u64 ktid;
 	int synx_state = SYNX_STATE_SIGNALED_SUCCESS;
 	struct cvp_hfi_device *hdev;
-	struct cvp_session_queue *sq;
-	u32 hfi_err = HFI_ERR_NONE;
-	struct cvp_hfi_msg_session_hdr_ext hdr;
-	bool clock_check = false;
+	struct cvp_fence_queue *q;
 
 	dprintk(CVP_SYNX, "%s %s\n", current->comm, __func__);
 
 	hdev = inst->core->device;
-	sq = &inst->session_queue_fence;
-	ktid = pkt->client_data.kdata;
+	q = &inst->fence_cmd_queue;
 
 	rc = cvp_synx_ops(inst, CVP_INPUT_SYNX, fc, &synx_state);
 	if (rc) {
@@ -472,30 +475,61 @@ static int cvp_fence_proc(struct msm_cvp_inst *inst,
 		goto exit;
 	}
 
+	/*
+	 * The response may be handled before session_send returns, so the
+	 * frame is claimable by its response from here on. in_submit keeps
+	 * the expiry path from claiming it until the send outcome is known.
+	 */
+	mutex_lock(&q->lock);
+	fc->submitted = true;
+	fc->in_submit = true;
+	fc->submit_time = jiffies;
+	mutex_unlock(&q->lock);
+
 	rc = call_hfi_op(hdev, session_send, (void *)inst->session,
 			(struct eva_kmd_hfi_packet *)pkt);
 	if (rc) {
+		/* Nothing was queued, so no response can have claimed it */
 		dprintk(CVP_ERR, "%s %s: Failed in call_hfi_op %d, %x\n",
 			current->comm, __func__, pkt->size, pkt->packet_type);
+		mutex_lock(&q->lock);
+		fc->submitted = false;
+		fc->in_submit = false;
+		mutex_unlock(&q->lock);
 		synx_state = SYNX_STATE_SIGNALED_ERROR;
 		goto exit;
 	}
 
-	timeout = msecs_to_jiffies(CVP_MAX_WAIT_TIME);
-	rc = cvp_wait_process_message(inst, sq, &ktid, timeout,
-				(struct eva_kmd_hfi_packet *)&hdr);
+	cvp_fence_submit_done(q, fc);
+	return 0;
+
+exit:
+	cvp_synx_ops(inst, CVP_OUTPUT_SYNX, fc, &synx_state);
+	return rc;
+}
+
+static void cvp_fence_complete(struct msm_cvp_inst *inst,
+			struct cvp_fence_command *fc,
+			struct cvp_hfi_msg_session_hdr_ext *hdr)
+{
+	int synx_state = SYNX_STATE_SIGNALED_SUCCESS;
+	u32 hfi_err = HFI_ERR_NONE;
+	bool clock_check = false;
+
+	if (!hdr) {
+		synx_state = SYNX_STATE_SIGNALED_ERROR;
+		goto exit;
+	}
 
 	/* Only FD support dcvs at certain FW */
 	if (!msm_cvp_dcvs_disable &&
-		hdr.packet_type == HFI_MSG_SESSION_CVP_FD) {
-		if (hdr.size == sizeof(struct cvp_hfi_msg_session_hdr_ext)
+		hdr->packet_type == HFI_MSG_SESSION_CVP_FD) {
+		if (hdr->size == sizeof(struct cvp_hfi_msg_session_hdr_ext)
 			+ sizeof(struct cvp_hfi_buf_type)) {
-			struct cvp_hfi_msg_session_hdr_ext *fhdr =
-				(struct cvp_hfi_msg_session_hdr_ext *)&hdr;
 			struct msm_cvp_core *core = inst->core;
 
 			dprintk(CVP_PWR, "busy cycle %d, total %d\n",
-				fhdr->busy_cycles, fhdr->total_cycles);
+				hdr->busy_cycles, hdr->total_cycles);
 
 			if (core && (core->dyn_clk.sum_fps[HFI_HW_FDU] ||
 				core->dyn_clk.sum_fps[HFI_HW_MPU] ||
@@ -505,37 +539,29 @@ static int cvp_fence_proc(struct msm_cvp_inst *inst,
 			}
 		} else {
 			dprintk(CVP_WARN, "dcvs is disabled, %d != %d + %d\n",
-				hdr.size, sizeof(struct cvp_hfi_msg_session_hdr_ext),
+				hdr->size, sizeof(struct cvp_hfi_msg_session_hdr_ext),
 				sizeof(struct cvp_hfi_buf_type));
 		}
 	}
-	hfi_err = hdr.error_type;
-	if (rc) {
-		dprintk(CVP_ERR, "%s %s: cvp_wait_process_message rc %d\n",
-			current->comm, __func__, rc);
-		synx_state = SYNX_STATE_SIGNALED_ERROR;
-		goto exit;
-	}
+	hfi_err = hdr->error_type;
 	if (hfi_err == HFI_ERR_SESSION_FLUSHED) {
-		dprintk(CVP_SYNX, "%s %s: cvp_wait_process_message flushed\n",
-			current->comm, __func__);
+		dprintk(CVP_SYNX, "%s: frame %llu flushed\n",
+			__func__, fc->frame_id);
 		synx_state = SYNX_STATE_SIGNALED_CANCEL;
 	} else if (hfi_err == HFI_ERR_SESSION_STREAM_CORRUPT) {
-		dprintk(CVP_INFO, "%s %s: cvp_wait_process_msg non-fatal %d\n",
-		current->comm, __func__, hfi_err);
+		dprintk(CVP_INFO, "%s: frame %llu non-fatal %d\n",
+			__func__, fc->frame_id, hfi_err);
 		synx_state = SYNX_STATE_SIGNALED_SUCCESS;
 	} else if (hfi_err != HFI_ERR_NONE) {
-		dprintk(CVP_ERR, "%s %s: cvp_wait_process_message hfi err %d\n",
-			current->comm, __func__, hfi_err);
+		dprintk(CVP_ERR, "%s: frame %llu hfi err %d\n",
+			__func__, fc->frame_id, hfi_err);
 		synx_state = SYNX_STATE_SIGNALED_CANCEL;
 	}
 
 exit:
-	rc = cvp_synx_ops(inst, CVP_OUTPUT_SYNX, fc, &synx_state);
+	cvp_synx_ops(inst, CVP_OUTPUT_SYNX, fc, &synx_state);
 	if (clock_check)
-		cvp_check_clock(inst,
-			(struct cvp_hfi_msg_session_hdr_ext *)&hdr);
-	return rc;
+		cvp_check_clock(inst, hdr);
 }
 
 static int cvp_alloc_fence_data(struct cvp_fence_command **f, u32 size)
@@ -566,6 +592,26 @@ static void cvp_free_fence_data(struct cvp_fence_command *f)
 	f = NULL;
 }
 
+static void cvp_fence_retire(struct msm_cvp_inst *inst,
+			struct cvp_fence_command *f)
+{
+	struct cvp_fence_queue *q = &inst->fence_cmd_queue;
+	bool idle;
+
+	mutex_lock(&q->lock);
+	cvp_release_synx(inst, f);
+	list_del_init(&f->list);
+	q->inflight--;
+	idle = !q->inflight;
+	mutex_unlock(&q->lock);
+
+	wake_up(&q->wq);
+	if (idle)
+		wake_up(&inst->session_queue_fence.wq);
+
+	cvp_free_fence_data(f);
+}
+
 static int cvp_fence_thread(void *data)
 {
 	int rc = 0;
@@ -574,7 +620,6 @@ static int cvp_fence_thread(void *data)
 	enum queue_state state;
 	struct cvp_fence_command *f;
 	struct cvp_hfi_cmd_session_hdr *pkt;
-	u32 *synx;
 	u64 ktid;
 
 	dprintk(CVP_SYNX, "Enter %s\n", current->comm);
@@ -600,25 +645,26 @@ wait:
 		goto wait;
 
 	pkt = f->pkt;
-	synx = (u32 *)f->synx;
 
 	ktid = pkt->client_data.kdata & (FENCE_BIT - 1);
 	dprintk(CVP_SYNX, "%s pkt type %d on ktid %llu frameID %llu\n",
 		current->comm, pkt->packet_type, ktid, f->frame_id);
 
-	rc = cvp_fence_proc(inst, f, pkt);
+	/*
+	 * Once submitted the frame is completed by the fence done thread,
+	 * this thread moves on to the next frame.
+	 */
+	rc = cvp_fence_submit(inst, f, pkt);
+	if (rc) {
+		dprintk(CVP_SYNX, "%s failed %d ktid %llu frameID %llu rc %d\n",
+			current->comm, pkt->packet_type, ktid, f->frame_id, rc);
+		cvp_fence_retire(inst, f);
+	}
 
 	mutex_lock(&q->lock);
-	cvp_release_synx(inst, f);
-	list_del_init(&f->list);
 	state = q->state;
 	mutex_unlock(&q->lock);
 
-	dprintk(CVP_SYNX, "%s done with %d ktid %llu frameID %llu rc %d\n",
-		current->comm, pkt->packet_type, ktid, f->frame_id, rc);
-
-	cvp_free_fence_data(f);
-
 	if (rc && state != QUEUE_START)
 		goto exit;
 
@@ -631,6 +677,137 @@ exit:
 	return rc;
 }
 
+static bool cvp_fence_done_wait(struct msm_cvp_inst *inst,
+			struct cvp_session_msg **msg, bool *stop)
+{
+	struct cvp_session_queue *sq = &inst->session_queue_fence;
+	struct cvp_fence_queue *q = &inst->fence_cmd_queue;
+
+	*msg = NULL;
+	*stop = false;
+
+	spin_lock(&sq->lock);
+	sq->wakeups++;
+	if (sq->state == QUEUE_INIT || sq->state == QUEUE_INVALID) {
+		/* The session is being deleted */
+		spin_unlock(&sq->lock);
+		*stop = true;
+		return true;
+	}
+	if (!list_empty(&sq->msgs)) {
+		*msg = list_first_entry(&sq->msgs, struct cvp_session_msg,
+					node);
+		list_del_init(&(*msg)->node);
+		sq->msg_count--;
+		spin_unlock(&sq->lock);
+		return true;
+	}
+	spin_unlock(&sq->lock);
+
+	/* Keep completing frames in flight after the queue is stopped */
+	mutex_lock(&q->lock);
+	if (q->state != QUEUE_START && !q->inflight)
+		*stop = true;
+	mutex_unlock(&q->lock);
+
+	return *stop;
+}
+
+static struct cvp_fence_command *cvp_fence_claim(struct cvp_fence_queue *q,
+			u64 kdata, unsigned long timeout, bool all)
+{
+	struct cvp_fence_command *f;
+
+	mutex_lock(&q->lock);
+	list_for_each_entry(f, &q->sched_list, list) {
+		if (!f->submitted || (!kdata && f->in_submit))
+			continue;
+
+		if (all || (kdata && f->pkt->client_data.kdata == kdata) ||
+			(!kdata && time_after(jiffies,
+				f->submit_time + timeout))) {
+			f->submitted = false;
+			mutex_unlock(&q->lock);
+			return f;
+		}
+	}
+	mutex_unlock(&q->lock);
+
+	return NULL;
+}
+
+static void cvp_fence_done_msg(struct msm_cvp_inst *inst,
+			struct cvp_session_msg *msg)
+{
+	struct cvp_fence_command *f;
+	struct cvp_hfi_msg_session_hdr_ext hdr;
+	u64 kdata;
+
+	memcpy(&hdr, &msg->pkt, sizeof(hdr));
+	kmem_cache_free(cvp_driver->msg_cache, msg);
+
+	kdata = hdr.client_data.kdata;
+	if (kdata >= get_pkt_array_size())
+		msm_cvp_unmap_frame(inst, kdata);
+
+	f = cvp_fence_claim(&inst->fence_cmd_queue, kdata, 0, false);
+	if (!f) {
+		dprintk(CVP_WARN, "%s: no frame in flight for ktid %llu\n",
+			__func__, kdata & (FENCE_BIT - 1));
+		return;
+	}
+
+	dprintk(CVP_SYNX, "%s: ktid %llu frameID %llu done in %u ms\n",
+		__func__, kdata & (FENCE_BIT - 1), f->frame_id,
+		jiffies_to_msecs(jiffies - f->submit_time));
+
+	cvp_fence_complete(inst, f, &hdr);
+	cvp_fence_retire(inst, f);
+}
+
+static void cvp_fence_expire(struct msm_cvp_inst *inst, unsigned long timeout,
+			bool all)
+{
+	struct cvp_fence_command *f;
+
+	while ((f = cvp_fence_claim(&inst->fence_cmd_queue, 0, timeout,
+				all))) {
+		dprintk(CVP_ERR, "%s: ktid %llu frameID %llu timed out\n",
+			__func__, f->pkt->client_data.kdata & (FENCE_BIT - 1),
+			f->frame_id);
+		cvp_fence_complete(inst, f, NULL);
+		cvp_fence_retire(inst, f);
+	}
+}
+
+static int cvp_fence_done_thread(void *data)
+{
+	struct msm_cvp_inst *inst = (struct msm_cvp_inst *)data;
+	struct cvp_session_queue *sq;
+	struct cvp_session_msg *msg;
+	unsigned long timeout;
+	bool stop;
+
+	dprintk(CVP_SYNX, "Enter %s\n", current->comm);
+
+	sq = &inst->session_queue_fence;
+	timeout = msecs_to_jiffies(CVP_MAX_WAIT_TIME);
+
+	do {
+		wait_event_interruptible_timeout(sq->wq,
+			cvp_fence_done_wait(inst, &msg, &stop), timeout);
+		if (msg)
+			cvp_fence_done_msg(inst, msg);
+
+		cvp_fence_expire(inst, timeout, stop);
+	} while (!stop);
+
+	dprintk(CVP_SYNX, "%s exit\n", current->comm);
+	cvp_put_inst(inst);
+	do_exit(0);
+	return 0;
+}
+
 static int msm_cvp_session_process_hfi_fence(struct msm_cvp_inst *inst,
 					struct eva_kmd_arg *arg)
 {
@@ -763,115 +940,201 @@ static bool is_subblock_profile_existed(struct msm_cvp_inst *inst)
 			inst->prop.ica_cycles);
 }
 
-static void aggregate_power_update(struct msm_cvp_core *core,
-	struct cvp_power_level *nrt_pwr,
-	struct cvp_power_level *rt_pwr,
-	unsigned int max_clk_rate)
+static void cvp_power_contrib_fill(struct msm_cvp_inst *inst,
+	struct cvp_power_contrib *c)
+{
+	int i;
+
+	memset(c, 0, sizeof(*c));
+	if (inst->state == MSM_CVP_CORE_INVALID ||
+		inst->state == MSM_CVP_CORE_UNINIT ||
+		!is_subblock_profile_existed(inst))
+		return;
+
+	dprintk(CVP_PROF, "pwrUpdate fdu %u od %u mpu %u ica %u\n",
+		inst->prop.fdu_cycles,
+		inst->prop.od_cycles,
+		inst->prop.mpu_cycles,
+		inst->prop.ica_cycles);
+
+	dprintk(CVP_PROF, "pwrUpdate fw %u fdu_o %u od_o %u mpu_o %u\n",
+		inst->prop.fw_cycles,
+		inst->prop.fdu_op_cycles,
+		inst->prop.od_op_cycles,
+		inst->prop.mpu_op_cycles);
+
+	dprintk(CVP_PROF, "pwrUpdate ica_o %u fw_o %u bw %u bw_o %u\n",
+		inst->prop.ica_op_cycles,
+		inst->prop.fw_op_cycles,
+		inst->prop.ddr_bw,
+		inst->prop.ddr_op_bw);
+
+	c->valid = true;
+	/* Non-realtime session use index 0 */
+	c->cls = (inst->prop.priority <= CVP_RT_PRIO_THRESHOLD) ? 0 : 1;
+	c->cycles[CVP_PWR_FDU] = inst->prop.fdu_cycles;
+	c->cycles[CVP_PWR_OD] = inst->prop.od_cycles;
+	c->cycles[CVP_PWR_MPU] = inst->prop.mpu_cycles;
+	c->cycles[CVP_PWR_ICA] = inst->prop.ica_cycles;
+	c->cycles[CVP_PWR_FW] = inst->prop.fw_cycles;
+	c->op_cycles[CVP_PWR_FDU] = inst->prop.fdu_op_cycles;
+	c->op_cycles[CVP_PWR_OD] = inst->prop.od_op_cycles;
+	c->op_cycles[CVP_PWR_MPU] = inst->prop.mpu_op_cycles;
+	c->op_cycles[CVP_PWR_ICA] = inst->prop.ica_op_cycles;
+	c->op_cycles[CVP_PWR_FW] = inst->prop.fw_op_cycles;
+	c->bw = inst->prop.ddr_bw;
+	c->op_bw = inst->prop.ddr_op_bw;
+	for (i = 0; i < HFI_MAX_HW_THREADS; i++)
+		c->fps[i] = inst->prop.fps[i];
+
+	dprintk(CVP_PWR, "%s:%d - fps fdu %d mpu %d od %d ica %d\n",
+		__func__, __LINE__,
+		inst->prop.fps[HFI_HW_FDU], inst->prop.fps[HFI_HW_MPU],
+		inst->prop.fps[HFI_HW_OD], inst->prop.fps[HFI_HW_ICA]);
+}
+
+static void cvp_power_aggr_sub(struct msm_cvp_core *core,
+	struct cvp_power_contrib *c)
+{
+	struct cvp_power_aggr *aggr = &core->pwr_aggr;
+	int i;
+
+	if (!c->valid)
+		return;
+
+	for (i = 0; i < CVP_PWR_BLK_MAX; i++) {
+		aggr->cycles[c->cls][i] -= c->cycles[i];
+		if (c->op_cycles[i] &&
+			c->op_cycles[i] >= aggr->op_max[c->cls][i])
+			aggr->max_stale[c->cls] = true;
+	}
+	aggr->bw[c->cls] -= c->bw;
+	if (c->op_bw && c->op_bw >= aggr->op_bw_max[c->cls])
+		aggr->max_stale[c->cls] = true;
+
+	for (i = 0; i < HFI_MAX_HW_THREADS; i++)
+		core->dyn_clk.sum_fps[i] -= c->fps[i];
+}
+
+static void cvp_power_aggr_add(struct msm_cvp_core *core,
+	struct cvp_power_contrib *c)
 {
+	struct cvp_power_aggr *aggr = &core->pwr_aggr;
+	int i;
+
+	if (!c->valid)
+		return;
+
+	for (i = 0; i < CVP_PWR_BLK_MAX; i++) {
+		aggr->cycles[c->cls][i] += c->cycles[i];
+		if (c->op_cycles[i] > aggr->op_max[c->cls][i])
+			aggr->op_max[c->cls][i] = c->op_cycles[i];
+	}
+	aggr->bw[c->cls] += c->bw;
+	if (c->op_bw > aggr->op_bw_max[c->cls])
+		aggr->op_bw_max[c->cls] = c->op_bw;
+
+	for (i = 0; i < HFI_MAX_HW_THREADS; i++)
+		core->dyn_clk.sum_fps[i] += c->fps[i];
+}
+
+static void cvp_power_aggr_rescan(struct msm_cvp_core *core, u32 cls)
+{
+	struct cvp_power_aggr *aggr = &core->pwr_aggr;
+	struct cvp_power_contrib *c;
 	struct msm_cvp_inst *inst;
 	int i;
-	unsigned long fdu_sum[2] = {0}, od_sum[2] = {0}, mpu_sum[2] = {0};
-	unsigned long ica_sum[2] = {0}, fw_sum[2] = {0};
-	unsigned long op_fdu_max[2] = {0}, op_od_max[2] = {0};
-	unsigned long op_mpu_max[2] = {0}, op_ica_max[2] = {0};
-	unsigned long op_fw_max[2] = {0}, bw_sum[2] = {0}, op_bw_max[2] = {0};
-	core->dyn_clk.sum_fps[HFI_HW_FDU] = 0;
-	core->dyn_clk.sum_fps[HFI_HW_MPU] = 0;
-	core->dyn_clk.sum_fps[HFI_HW_OD]  = 0;
-	core->dyn_clk.sum_fps[HFI_HW_ICA] = 0;
+
+	memset(aggr->op_max[cls], 0, sizeof(aggr->op_max[cls]));
+	aggr->op_bw_max[cls] = 0;
 
 	list_for_each_entry(inst, &core->instances, list) {
-		if (inst->state == MSM_CVP_CORE_INVALID ||
-			inst->state == MSM_CVP_CORE_UNINIT ||
-			!is_subblock_profile_existed(inst))
+		c = &inst->pwr_contrib;
+		if (!c->valid || c->cls != cls)
 			continue;
-		if (inst->prop.priority <= CVP_RT_PRIO_THRESHOLD) {
-			/* Non-realtime session use index 0 */
-			i = 0;
-		} else {
-			i = 1;
-		}
-		dprintk(CVP_PROF, "pwrUpdate fdu %u od %u mpu %u ica %u\n",
-			inst->prop.fdu_cycles,
-			inst->prop.od_cycles,
-			inst->prop.mpu_cycles,
-			inst->prop.ica_cycles);
+		for (i = 0; i < CVP_PWR_BLK_MAX; i++)
+			if (c->op_cycles[i] > aggr->op_max[cls][i])
+				aggr->op_max[cls][i] = c->op_cycles[i];
+		if (c->op_bw > aggr->op_bw_max[cls])
+			aggr->op_bw_max[cls] = c->op_bw;
+	}
 
-		dprintk(CVP_PROF, "pwrUpdate fw %u fdu_o %u od_o %u mpu_o %u\n",
-			inst->prop.fw_cycles,
-			inst->prop.fdu_op_cycles,
-			inst->prop.od_op_cycles,
-			inst->prop.mpu_op_cycles);
-
-		dprintk(CVP_PROF, "pwrUpdate ica_o %u fw_o %u bw %u bw_o %u\n",
-			inst->prop.ica_op_cycles,
-			inst->prop.fw_op_cycles,
-			inst->prop.ddr_bw,
-			inst->prop.ddr_op_bw);
-
-		fdu_sum[i] += inst->prop.fdu_cycles;
-		od_sum[i] += inst->prop.od_cycles;
-		mpu_sum[i] += inst->prop.mpu_cycles;
-		ica_sum[i] += inst->prop.ica_cycles;
-		fw_sum[i] += inst->prop.fw_cycles;
-		op_fdu_max[i] =
-			(op_fdu_max[i] >= inst->prop.fdu_op_cycles) ?
-			op_fdu_max[i] : inst->prop.fdu_op_cycles;
-		op_od_max[i] =
-			(op_od_max[i] >= inst->prop.od_op_cycles) ?
-			op_od_max[i] : inst->prop.od_op_cycles;
-		op_mpu_max[i] =
-			(op_mpu_max[i] >= inst->prop.mpu_op_cycles) ?
-			op_mpu_max[i] : inst->prop.mpu_op_cycles;
-		op_ica_max[i] =
-			(op_ica_max[i] >= inst->prop.ica_op_cycles) ?
-			op_ica_max[i] : inst->prop.ica_op_cycles;
-		op_fw_max[i] =
-			(op_fw_max[i] >= inst->prop.fw_op_cycles) ?
-			op_fw_max[i] : inst->prop.fw_op_cycles;
-		bw_sum[i] += inst->prop.ddr_bw;
-		op_bw_max[i] =
-			(op_bw_max[i] >= inst->prop.ddr_op_bw) ?
-			op_bw_max[i] : inst->prop.ddr_op_bw;
-
-		dprintk(CVP_PWR, "%s:%d - fps fdu %d mpu %d od %d ica %d\n",
-			__func__, __LINE__,
-			inst->prop.fps[HFI_HW_FDU], inst->prop.fps[HFI_HW_MPU],
-			inst->prop.fps[HFI_HW_OD], inst->prop.fps[HFI_HW_ICA]);
-		core->dyn_clk.sum_fps[HFI_HW_FDU] += inst->prop.fps[HFI_HW_FDU];
-		core->dyn_clk.sum_fps[HFI_HW_MPU] += inst->prop.fps[HFI_HW_MPU];
-		core->dyn_clk.sum_fps[HFI_HW_OD] += inst->prop.fps[HFI_HW_OD];
-		core->dyn_clk.sum_fps[HFI_HW_ICA] += inst->prop.fps[HFI_HW_ICA];
-		dprintk(CVP_PWR, "%s:%d - sum_fps fdu %d mpu %d od %d ica %d\n",
-			__func__, __LINE__,
-			core->dyn_clk.sum_fps[HFI_HW_FDU],
-			core->dyn_clk.sum_fps[HFI_HW_MPU],
-			core->dyn_clk.sum_fps[HFI_HW_OD],
-			core->dyn_clk.sum_fps[HFI_HW_ICA]);
-	}
-
-	for (i = 0; i < 2; i++) {
-		fdu_sum[i] = max_3(fdu_sum[i], od_sum[i], mpu_sum[i]);
-		fdu_sum[i] = max_3(fdu_sum[i], ica_sum[i], fw_sum[i]);
-
-		op_fdu_max[i] = max_3(op_fdu_max[i], op_od_max[i],
-			op_mpu_max[i]);
-		op_fdu_max[i] = max_3(op_fdu_max[i],
-			op_ica_max[i], op_fw_max[i]);
-		op_fdu_max[i] =
-			(op_fdu_max[i] > max_clk_rate) ?
-			max_clk_rate : op_fdu_max[i];
-		bw_sum[i] = (bw_sum[i] >= op_bw_max[i]) ?
-			bw_sum[i] : op_bw_max[i];
-	}
-
-	nrt_pwr->core_sum += fdu_sum[0];
-	nrt_pwr->op_core_sum = (nrt_pwr->op_core_sum >= op_fdu_max[0]) ?
-			nrt_pwr->op_core_sum : op_fdu_max[0];
+	aggr->max_stale[cls] = false;
+	aggr->nr_rescans++;
+}
+
+/**
+ * msm_cvp_power_aggr_update(): replace the contribution of @inst in the
+ * core power aggregate with its current profile.
+ * @inst: session whose profile or state changed
+ * @remove: drop the contribution, used when the session leaves the core
+ *
+ * Ensure caller acquires clk_lock!
+ */
+void msm_cvp_power_aggr_update(struct msm_cvp_inst *inst, bool remove)
+{
+	struct msm_cvp_core *core = inst->core;
+	struct cvp_power_contrib c;
+
+	if (remove)
+		memset(&c, 0, sizeof(c));
+	else
+		cvp_power_contrib_fill(inst, &c);
+
+	cvp_power_aggr_sub(core, &inst->pwr_contrib);
+	cvp_power_aggr_add(core, &c);
+	inst->pwr_contrib = c;
+	core->pwr_aggr.nr_updates++;
+
+	dprintk(CVP_PWR, "%s:%d - sum_fps fdu %d mpu %d od %d ica %d\n",
+		__func__, __LINE__,
+		core->dyn_clk.sum_fps[HFI_HW_FDU],
+		core->dyn_clk.sum_fps[HFI_HW_MPU],
+		core->dyn_clk.sum_fps[HFI_HW_OD],
+		core->dyn_clk.sum_fps[HFI_HW_ICA]);
+}
+
+static void aggregate_power_update(struct msm_cvp_core *core,
+	struct cvp_power_level *nrt_pwr,
+	struct cvp_power_level *rt_pwr,
+	unsigned int max_clk_rate)
+{
+	struct cvp_power_aggr *aggr = &core->pwr_aggr;
+	int i;
+	unsigned long core_sum[2] = {0}, op_core_max[2] = {0};
+	unsigned long bw_sum[2] = {0};
+
+	for (i = 0; i < CVP_PWR_CLASS_MAX; i++) {
+		if (aggr->max_stale[i])
+			cvp_power_aggr_rescan(core, i);
+
+		core_sum[i] = max_3(aggr->cycles[i][CVP_PWR_FDU],
+			aggr->cycles[i][CVP_PWR_OD],
+			aggr->cycles[i][CVP_PWR_MPU]);
+		core_sum[i] = max_3(core_sum[i],
+			aggr->cycles[i][CVP_PWR_ICA],
+			aggr->cycles[i][CVP_PWR_FW]);
+
+		op_core_max[i] = max_3(aggr->op_max[i][CVP_PWR_FDU],
+			aggr->op_max[i][CVP_PWR_OD],
+			aggr->op_max[i][CVP_PWR_MPU]);
+		op_core_max[i] = max_3(op_core_max[i],
+			aggr->op_max[i][CVP_PWR_ICA],
+			aggr->op_max[i][CVP_PWR_FW]);
+		op_core_max[i] =
+			(op_core_max[i] > max_clk_rate) ?
+			max_clk_rate : op_core_max[i];
+		bw_sum[i] = (aggr->bw[i] >= aggr->op_bw_max[i]) ?
+			aggr->bw[i] : aggr->op_bw_max[i];
+	}
+
+	nrt_pwr->core_sum += core_sum[0];
+	nrt_pwr->op_core_sum = (nrt_pwr->op_core_sum >= op_core_max[0]) ?
+			nrt_pwr->op_core_sum : op_core_max[0];
 	nrt_pwr->bw_sum += bw_sum[0];
-	rt_pwr->core_sum += fdu_sum[1];
-	rt_pwr->op_core_sum = (rt_pwr->op_core_sum >= op_fdu_max[1]) ?
-			rt_pwr->op_core_sum : op_fdu_max[1];
+	rt_pwr->core_sum += core_sum[1];
+	rt_pwr->op_core_sum = (rt_pwr->op_core_sum >= op_core_max[1]) ?
+			rt_pwr->op_core_sum : op_core_max[1];
 	rt_pwr->bw_sum += bw_sum[1];
 }
 
@@ -885,10 +1148,12 @@ static void aggregate_power_update(struct msm_cvp_core *core,
  * Clock vote from realtime session will be hard request. If aggregated
  * session clock request exceeds max limit, the function will return
  * error.
+ * Clocks and bus are only voted when the resulting table level or
+ * bandwidth differs from what is currently voted.
  *
  * Ensure caller acquires clk_lock!
  */
-static int adjust_bw_freqs(void)
+static int adjust_bw_freqs(struct msm_cvp_inst *inst)
 {
 	struct msm_cvp_core *core;
 	struct iris_hfi_device *hdev;
@@ -902,6 +1167,7 @@ static int adjust_bw_freqs(void)
 	unsigned long tmp, core_sum, op_core_sum, bw_sum;
 	int i, rc = 0;
 	unsigned long ctrl_freq;
+	bool clk_voted = false, bus_voted = false;
 
 	core = list_first_entry(&cvp_driver->cores, struct msm_cvp_core, list);
 
@@ -960,13 +1226,18 @@ static int adjust_bw_freqs(void)
 	tmp = core->curr_freq;
 	core->curr_freq = core_sum;
 	core->orig_core_sum = core_sum;
-	rc = msm_cvp_set_clocks(core);
-	if (rc) {
-		dprintk(CVP_ERR,
-			"Failed to set clock rate %u %s: %d %s\n",
-			core_sum, cl->name, rc, __func__);
-		core->curr_freq = tmp;
-		return rc;
+	if (hdev->clk_freq != core_sum || msm_cvp_clock_voting) {
+		rc = msm_cvp_set_clocks(core);
+		if (rc) {
+			dprintk(CVP_ERR,
+				"Failed to set clock rate %u %s: %d %s\n",
+				core_sum, cl->name, rc, __func__);
+			core->curr_freq = tmp;
+			return rc;
+		}
+		clk_voted = true;
+		core->pwr_aggr.nr_clk_votes++;
+		trace_msm_cvp_perf_clock_scale(cl->name, core_sum);
 	}
 
 	ctrl_freq = (core->curr_freq*3)>>1;
@@ -979,7 +1250,15 @@ static int adjust_bw_freqs(void)
 	}
 
 	hdev->clk_freq = core->curr_freq;
-	rc = msm_cvp_set_bw(bus, bw_sum);
+	if (bus->voted_bw != bw_sum) {
+		rc = msm_cvp_set_bw(bus, bw_sum);
+		bus_voted = true;
+		core->pwr_aggr.nr_bus_votes++;
+		trace_msm_cvp_perf_bus_vote(bus->name, bw_sum);
+	}
+
+	trace_msm_cvp_power_update(inst, core_sum, bw_sum,
+		clk_voted, bus_voted);
 
 	return rc;
 }
@@ -1002,7 +1281,8 @@ int msm_cvp_update_power(struct msm_cvp_inst *inst)
 	core = inst->core;
 
 	mutex_lock(&core->clk_lock);
-	rc = adjust_bw_freqs();
+	msm_cvp_power_aggr_update(inst, false);
+	rc = adjust_bw_freqs(inst);
 	mutex_unlock(&core->clk_lock);
 	cvp_put_inst(s);
 
@@ -1085,6 +1365,7 @@ static int cvp_fence_thread_start(struct msm_cvp_inst *inst)
 	q = &inst->fence_cmd_queue;
 	mutex_lock(&q->lock);
 	q->state = QUEUE_START;
+	q->depth = max_t(u32, msm_cvp_fence_depth, 1);
 	mutex_unlock(&q->lock);
 
 	for (i = 0; i < inst->prop.fthread_nr; ++i) {
@@ -1102,6 +1383,19 @@ static int cvp_fence_thread_start(struct msm_cvp_inst *inst)
 		}
 	}
 
+	if (!cvp_get_inst_validate(inst->core, inst)) {
+		rc = -ECONNRESET;
+		goto exit;
+	}
+
+	thread = kthread_run(cvp_fence_done_thread, inst, "fdone");
+	if (IS_ERR(thread)) {
+		dprintk(CVP_ERR, "%s create fdone fail", __func__);
+		cvp_put_inst(inst);
+		rc = -ECHILD;
+		goto exit;
+	}
+
 	sq = &inst->session_queue_fence;
 	spin_lock(&sq->lock);
 	sq->state = QUEUE_START;
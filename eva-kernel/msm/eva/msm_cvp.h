@@ -37,5 +37,6 @@ int msm_cvp_session_create(struct msm_cvp_inst *inst);
 int msm_cvp_session_delete(struct msm_cvp_inst *inst);
 int msm_cvp_get_session_info(struct msm_cvp_inst *inst, u32 *session);
 int msm_cvp_update_power(struct msm_cvp_inst *inst);
+void msm_cvp_power_aggr_update(struct msm_cvp_inst *inst, bool remove);
 int cvp_clean_session_queues(struct msm_cvp_inst *inst);
 #endif
@@ -394,29 +394,29 @@ static struct msm_cvp_smem *msm_cvp_session_find_smem(struct msm_cvp_inst *inst,
 				struct dma_buf *dma_buf)
 {
 	struct msm_cvp_smem *smem;
-	int i;
-
-	if (inst->dma_cache.nr > MAX_DMABUF_NUMS)
-		return NULL;
 
 	mutex_lock(&inst->dma_cache.lock);
-	for (i = 0; i < inst->dma_cache.nr; i++)
-		if (inst->dma_cache.entries[i]->dma_buf == dma_buf) {
-			SET_USE_BITMAP(i, inst);
-			smem = inst->dma_cache.entries[i];
-			smem->bitmap_index = i;
-			atomic_inc(&smem->refcount);
-			/*
-			 * If we find it, it means we already increased
-			 * refcount before, so we put it to avoid double
-			 * incremental.
-			 */
-			msm_cvp_smem_put_dma_buf(smem->dma_buf);
-			mutex_unlock(&inst->dma_cache.lock);
-			print_smem(CVP_MEM, "found", inst, smem);
-			return smem;
-		}
+	hash_for_each_possible(inst->dma_cache.index, smem, hnode,
+			(unsigned long)dma_buf) {
+		if (smem->dma_buf != dma_buf)
+			continue;
 
+		SET_USE_BITMAP(smem->bitmap_index, inst);
+		/* Back in use, no longer an eviction candidate */
+		if (atomic_inc_return(&smem->refcount) == 1)
+			list_del_init(&smem->lru);
+		inst->dma_cache.hits++;
+		/*
+		 * If we find it, it means we already increased
+		 * refcount before, so we put it to avoid double
+		 * incremental.
+		 */
+		msm_cvp_smem_put_dma_buf(smem->dma_buf);
+		mutex_unlock(&inst->dma_cache.lock);
+		print_smem(CVP_MEM, "found", inst, smem);
+		return smem;
+	}
+	inst->dma_cache.misses++;
 	mutex_unlock(&inst->dma_cache.lock);
 
 	return NULL;
@@ -430,30 +430,34 @@ static int msm_cvp_session_add_smem(struct msm_cvp_inst *inst,
 
 	mutex_lock(&inst->dma_cache.lock);
 	if (inst->dma_cache.nr < MAX_DMABUF_NUMS) {
-		inst->dma_cache.entries[inst->dma_cache.nr] = smem;
-		SET_USE_BITMAP(inst->dma_cache.nr, inst);
-		smem->bitmap_index = inst->dma_cache.nr;
+		i = inst->dma_cache.nr;
 		inst->dma_cache.nr++;
-		i = smem->bitmap_index;
+	} else if (!list_empty(&inst->dma_cache.lru)) {
+		/* Evict the least recently released mapping */
+		smem2 = list_first_entry(&inst->dma_cache.lru,
+				struct msm_cvp_smem, lru);
+		list_del_init(&smem2->lru);
+		hash_del(&smem2->hnode);
+		i = smem2->bitmap_index;
+		inst->dma_cache.evictions++;
+		print_smem(CVP_MEM, "evict", inst, smem2);
+
+		msm_cvp_unmap_smem(inst, smem2, "unmap cpu");
+		msm_cvp_smem_put_dma_buf(smem2->dma_buf);
+		kmem_cache_free(cvp_driver->smem_cache, smem2);
 	} else {
-		i = find_first_zero_bit(&inst->dma_cache.usage_bitmap,
-				MAX_DMABUF_NUMS);
-		if (i < MAX_DMABUF_NUMS) {
-			smem2 = inst->dma_cache.entries[i];
-			msm_cvp_unmap_smem(inst, smem2, "unmap cpu");
-			msm_cvp_smem_put_dma_buf(smem2->dma_buf);
-			kmem_cache_free(cvp_driver->smem_cache, smem2);
-
-			inst->dma_cache.entries[i] = smem;
-			smem->bitmap_index = i;
-			SET_USE_BITMAP(i, inst);
-		} else {
-			dprintk(CVP_WARN, "%s: not enough memory\n", __func__);
-			mutex_unlock(&inst->dma_cache.lock);
-			return -ENOMEM;
-		}
+		dprintk(CVP_WARN, "%s: not enough memory\n", __func__);
+		mutex_unlock(&inst->dma_cache.lock);
+		return -ENOMEM;
 	}
 
+	inst->dma_cache.entries[i] = smem;
+	smem->bitmap_index = i;
+	SET_USE_BITMAP(i, inst);
+	INIT_LIST_HEAD(&smem->lru);
+	hash_add(inst->dma_cache.index, &smem->hnode,
+		(unsigned long)smem->dma_buf);
+
 	atomic_inc(&smem->refcount);
 	mutex_unlock(&inst->dma_cache.lock);
 	dprintk(CVP_MEM, "Add entry %d into cache\n", i);
@@ -461,6 +465,17 @@ static int msm_cvp_session_add_smem(struct msm_cvp_inst *inst,
 	return 0;
 }
 
+/* Drop a frame reference on a cached mapping, dma_cache.lock held */
+static void msm_cvp_session_put_smem(struct msm_cvp_inst *inst,
+				struct msm_cvp_smem *smem)
+{
+	if (!atomic_dec_and_test(&smem->refcount))
+		return;
+
+	CLEAR_USE_BITMAP(smem->bitmap_index, inst);
+	list_add_tail(&smem->lru, &inst->dma_cache.lru);
+}
+
 static struct msm_cvp_smem *msm_cvp_session_get_smem(struct msm_cvp_inst *inst,
 						struct cvp_buf_type *buf)
 {
@@ -506,7 +521,7 @@ static struct msm_cvp_smem *msm_cvp_session_get_smem(struct msm_cvp_inst *inst,
 			__func__, buf->offset, buf->size);
 		if (found) {
 			mutex_lock(&inst->dma_cache.lock);
-			atomic_dec(&smem->refcount);
+			msm_cvp_session_put_smem(inst, smem);
 			mutex_unlock(&inst->dma_cache.lock);
 			return NULL;
 		}
@@ -630,11 +645,8 @@ static void msm_cvp_unmap_frame_buf(struct msm_cvp_inst *inst,
 			buf->smem = NULL;
 		} else {
 			mutex_lock(&inst->dma_cache.lock);
-			if (atomic_dec_and_test(&smem->refcount)) {
-				CLEAR_USE_BITMAP(smem->bitmap_index, inst);
-				print_smem(CVP_MEM, "Map dereference",
-					inst, smem);
-			}
+			msm_cvp_session_put_smem(inst, smem);
+			print_smem(CVP_MEM, "Map dereference", inst, smem);
 			mutex_unlock(&inst->dma_cache.lock);
 		}
 	}
@@ -644,7 +656,7 @@ static void msm_cvp_unmap_frame_buf(struct msm_cvp_inst *inst,
 
 void msm_cvp_unmap_frame(struct msm_cvp_inst *inst, u64 ktid)
 {
-	struct msm_cvp_frame *frame, *dummy1;
+	struct msm_cvp_frame *frame;
 	bool found;
 
 	if (!inst) {
@@ -658,10 +670,11 @@ void msm_cvp_unmap_frame(struct msm_cvp_inst *inst, u64 ktid)
 
 	found = false;
 	mutex_lock(&inst->frames.lock);
-	list_for_each_entry_safe(frame, dummy1, &inst->frames.list, list) {
+	hash_for_each_possible(inst->frame_hash, frame, hnode, ktid) {
 		if (frame->ktid == ktid) {
 			found = true;
 			list_del(&frame->list);
+			hash_del(&frame->hnode);
 			break;
 		}
 	}
@@ -710,10 +723,7 @@ int msm_cvp_unmap_user_persist(struct msm_cvp_inst *inst,
 				pbuf->smem = NULL;
 			} else {
 				mutex_lock(&inst->dma_cache.lock);
-				if (atomic_dec_and_test(&smem->refcount))
-					CLEAR_USE_BITMAP(
-						smem->bitmap_index,
-						inst);
+				msm_cvp_session_put_smem(inst, smem);
 				mutex_unlock(&inst->dma_cache.lock);
 			}
 
@@ -852,6 +862,7 @@ int msm_cvp_map_frame(struct msm_cvp_inst *inst,
 
 	mutex_lock(&inst->frames.lock);
 	list_add_tail(&frame->list, &inst->frames.list);
+	hash_add(inst->frame_hash, &frame->hnode, ktid);
 	mutex_unlock(&inst->frames.lock);
 	dprintk(CVP_MEM, "%s: map frame %llu\n", __func__, ktid);
 
@@ -861,16 +872,20 @@ int msm_cvp_map_frame(struct msm_cvp_inst *inst,
 int msm_cvp_session_deinit_buffers(struct msm_cvp_inst *inst)
 {
 	int rc = 0, i;
+	u32 nr_dsp = 0;
+	bool batched = false;
 	struct cvp_internal_buf *cbuf, *dummy;
 	struct msm_cvp_frame *frame, *dummy1;
 	struct msm_cvp_smem *smem;
 	struct cvp_hal_session *session;
+	struct cvp_dsp_buf_desc *descs = NULL;
 
 	session = (struct cvp_hal_session *)inst->session;
 
 	mutex_lock(&inst->frames.lock);
 	list_for_each_entry_safe(frame, dummy1, &inst->frames.list, list) {
 		list_del(&frame->list);
+		hash_del(&frame->hnode);
 		msm_cvp_unmap_frame_buf(inst, frame);
 	}
 	mutex_unlock(&inst->frames.lock);
@@ -883,25 +898,63 @@ int msm_cvp_session_deinit_buffers(struct msm_cvp_inst *inst)
 		} else if (!(smem->flags & SMEM_PERSIST)) {
 			print_smem(CVP_WARN, "in use", inst, smem);
 		}
+		hash_del(&smem->hnode);
+		list_del_init(&smem->lru);
 		msm_cvp_unmap_smem(inst, smem, "unmap cpu");
 		msm_cvp_smem_put_dma_buf(smem->dma_buf);
 		kmem_cache_free(cvp_driver->smem_cache, smem);
 		inst->dma_cache.entries[i] = NULL;
 	}
+	inst->dma_cache.nr = 0;
+	inst->dma_cache.usage_bitmap = 0;
 	mutex_unlock(&inst->dma_cache.lock);
 
 	mutex_lock(&inst->cvpdspbufs.lock);
+	list_for_each_entry(cbuf, &inst->cvpdspbufs.list, list)
+		if (cbuf->ownership == CLIENT)
+			nr_dsp++;
+
+	/* Deregister all client buffers with the DSP in one batch */
+	if (nr_dsp)
+		descs = kcalloc(nr_dsp, sizeof(*descs), GFP_KERNEL);
+	if (descs) {
+		i = 0;
+		list_for_each_entry(cbuf, &inst->cvpdspbufs.list, list) {
+			if (cbuf->ownership != CLIENT)
+				continue;
+			descs[i].fd = cbuf->fd;
+			descs[i].fd_size = cbuf->smem->dma_buf->size;
+			descs[i].size = cbuf->size;
+			descs[i].offset = cbuf->offset;
+			descs[i].index = cbuf->index;
+			descs[i].iova = (uint32_t)cbuf->smem->device_addr;
+			i++;
+		}
+		rc = cvp_dsp_deregister_buffers(hash32_ptr(session),
+				descs, nr_dsp);
+		for (i = 0; i < nr_dsp; i++)
+			if (descs[i].rc)
+				dprintk(CVP_ERR,
+				"%s: failed dsp deregistration fd=%d rc=%d",
+				__func__, descs[i].fd, descs[i].rc);
+		kfree(descs);
+		batched = true;
+	}
+
 	list_for_each_entry_safe(cbuf, dummy, &inst->cvpdspbufs.list, list) {
 		print_internal_buffer(CVP_MEM, "remove dspbufs", inst, cbuf);
 		if (cbuf->ownership == CLIENT) {
-			rc = cvp_dsp_deregister_buffer(hash32_ptr(session),
-				cbuf->fd, cbuf->smem->dma_buf->size, cbuf->size,
-				cbuf->offset, cbuf->index,
-				(uint32_t)cbuf->smem->device_addr);
-			if (rc)
-				dprintk(CVP_ERR,
-				"%s: failed dsp deregistration fd=%d rc=%d",
-				__func__, cbuf->fd, rc);
+			if (!batched) {
+				rc = cvp_dsp_deregister_buffer(
+					hash32_ptr(session), cbuf->fd,
+					cbuf->smem->dma_buf->size, cbuf->size,
+					cbuf->offset, cbuf->index,
+					(uint32_t)cbuf->smem->device_addr);
+				if (rc)
+					dprintk(CVP_ERR,
+					"%s: failed dsp deregistration fd=%d rc=%d",
+					__func__, cbuf->fd, rc);
+			}
 			msm_cvp_unmap_smem(inst, cbuf->smem, "unmap dsp");
 			msm_cvp_smem_put_dma_buf(cbuf->smem->dma_buf);
 		} else if (cbuf->ownership == DSP) {
@@ -11,10 +11,12 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-heap.h>
 #include <linux/refcount.h>
+#include <linux/hashtable.h>
 #include <media/msm_eva_private.h>
 
 #define MAX_FRAME_BUFFER_NUMS 30
 #define MAX_DMABUF_NUMS 64
+#define DMAMAP_CACHE_HASH_BITS 6
 
 struct msm_cvp_inst;
 struct msm_cvp_platform_resources;
@@ -64,6 +66,8 @@ struct cvp_dma_mapping_info {
 
 struct msm_cvp_smem {
 	struct list_head list;
+	struct hlist_node hnode;
+	struct list_head lru;
 	atomic_t refcount;
 	struct dma_buf *dma_buf;
 	void *kvaddr;
@@ -75,11 +79,21 @@ struct msm_cvp_smem {
 	struct cvp_dma_mapping_info mapping_info;
 };
 
+/*
+ * Cached mappings are indexed by dma_buf in @index. Entries whose refcount
+ * dropped to zero sit on @lru, least recently released first, and are the
+ * eviction candidates once all MAX_DMABUF_NUMS slots are taken.
+ */
 struct cvp_dmamap_cache {
 	unsigned long usage_bitmap;
 	struct mutex lock;
 	struct msm_cvp_smem *entries[MAX_DMABUF_NUMS];
 	unsigned int nr;
+	DECLARE_HASHTABLE(index, DMAMAP_CACHE_HASH_BITS);
+	struct list_head lru;
+	u64 hits;
+	u64 misses;
+	u64 evictions;
 };
 
 static inline void INIT_DMAMAP_CACHE(struct cvp_dmamap_cache *cache)
@@ -87,6 +101,11 @@ static inline void INIT_DMAMAP_CACHE(struct cvp_dmamap_cache *cache)
 	mutex_init(&cache->lock);
 	cache->usage_bitmap = 0;
 	cache->nr = 0;
+	hash_init(cache->index);
+	INIT_LIST_HEAD(&cache->lru);
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
 }
 
 static inline void DEINIT_DMAMAP_CACHE(struct cvp_dmamap_cache *cache)
@@ -130,6 +149,7 @@ struct cvp_internal_buf {
 
 struct msm_cvp_frame {
 	struct list_head list;
+	struct hlist_node hnode;
 	struct cvp_internal_buf bufs[MAX_FRAME_BUFFER_NUMS];
 	u32 nr;
 	u64 ktid;
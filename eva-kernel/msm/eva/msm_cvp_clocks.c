@@ -457,6 +457,8 @@ int msm_cvp_set_bw(struct bus_info *bus, unsigned long bw)
 	if (rc)
 		dprintk(CVP_ERR, "Failed voting bus %s to ab %u\n",
 			bus->name, bw);
+	else
+		bus->voted_bw = bw;
 
 	return rc;
 }
@@ -631,6 +631,7 @@ static void handle_sys_error(enum hal_command_response cmd, void *data)
 				inst->state);
 		if (inst->state != MSM_CVP_CORE_INVALID) {
 			change_cvp_inst_state(inst, MSM_CVP_CORE_INVALID);
+			msm_cvp_power_aggr_update(inst, true);
 			if (cvp_clean_session_queues(inst))
 				dprintk(CVP_ERR, "Failed to clean fences\n");
 			for (i = 0; i < ARRAY_SIZE(inst->completions); i++)
@@ -92,6 +92,8 @@ static void __init_fence_queue(struct msm_cvp_inst *inst)
 	init_waitqueue_head(&inst->fence_cmd_queue.wq);
 	inst->fence_cmd_queue.state = QUEUE_ACTIVE;
 	inst->fence_cmd_queue.mode = OP_NORMAL;
+	inst->fence_cmd_queue.inflight = 0;
+	inst->fence_cmd_queue.depth = 1;
 
 	spin_lock_init(&inst->session_queue_fence.lock);
 	INIT_LIST_HEAD(&inst->session_queue_fence.msgs);
@@ -177,6 +179,7 @@ void *msm_cvp_open(int core_id, int session_type)
 	INIT_DMAMAP_CACHE(&inst->dma_cache);
 	INIT_MSM_CVP_LIST(&inst->cvpdspbufs);
 	INIT_MSM_CVP_LIST(&inst->frames);
+	hash_init(inst->frame_hash);
 
 	init_waitqueue_head(&inst->event_handler.wq);
 
@@ -356,6 +359,7 @@ int msm_cvp_destroy(struct msm_cvp_inst *inst)
 	/* Ensure no path has core->clk_lock and core->lock sequence */
 	mutex_lock(&core->lock);
 	mutex_lock(&core->clk_lock);
+	msm_cvp_power_aggr_update(inst, true);
 	/* inst->list lives in core->instances */
 	list_del(&inst->list);
 	mutex_unlock(&core->clk_lock);
@@ -35,6 +35,7 @@ bool msm_cvp_mmrm_enabled = !true;
 #endif
 bool msm_cvp_dcvs_disable = !true;
 int msm_cvp_minidump_enable = !1;
+int msm_cvp_fence_depth = 4;
 
 #define MAX_DBG_BUF_SIZE 4096
 
@@ -107,6 +108,12 @@ static ssize_t core_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "irq: %u\n", fw_info.irq);
 
 err_fw_info:
+	mutex_lock(&core->clk_lock);
+	cur += write_str(cur, end - cur,
+		"power updates: %u rescans: %u clk votes: %u bus votes: %u\n",
+		core->pwr_aggr.nr_updates, core->pwr_aggr.nr_rescans,
+		core->pwr_aggr.nr_clk_votes, core->pwr_aggr.nr_bus_votes);
+	mutex_unlock(&core->clk_lock);
 	for (i = SYS_MSG_START; i < SYS_MSG_END; i++) {
 		cur += write_str(cur, end - cur, "completions[%d]: %s\n", i,
 			completion_done(&core->completions[SYS_MSG_INDEX(i)]) ?
@@ -254,6 +261,7 @@ struct dentry *msm_cvp_debugfs_init_drv(void)
 	debugfs_create_u32("debug_output", 0644, dir, &msm_cvp_debug_out);
 	debugfs_create_u32("minidump_enable", 0644, dir,
 			&msm_cvp_minidump_enable);
+	debugfs_create_u32("fence_depth", 0644, dir, &msm_cvp_fence_depth);
 	debugfs_create_bool("fw_coverage", 0644, dir, &msm_cvp_fw_coverage);
 	debugfs_create_bool("disable_thermal_mitigation", 0644, dir,
 			&msm_cvp_thermal_mitigation_disabled);
@@ -536,6 +544,29 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 		"pending" : "done");
 	}
 
+	spin_lock(&inst->session_queue.lock);
+	cur += write_str(cur, end - cur,
+		"session queue: depth %u max %u msgs %llu wakeups %llu\n",
+		inst->session_queue.msg_count,
+		inst->session_queue.max_msg_count,
+		inst->session_queue.msg_total, inst->session_queue.wakeups);
+	spin_unlock(&inst->session_queue.lock);
+	spin_lock(&inst->session_queue_fence.lock);
+	cur += write_str(cur, end - cur,
+		"fence queue: depth %u max %u msgs %llu wakeups %llu\n",
+		inst->session_queue_fence.msg_count,
+		inst->session_queue_fence.max_msg_count,
+		inst->session_queue_fence.msg_total,
+		inst->session_queue_fence.wakeups);
+	spin_unlock(&inst->session_queue_fence.lock);
+
+	mutex_lock(&inst->dma_cache.lock);
+	cur += write_str(cur, end - cur,
+		"dma cache: entries %u hits %llu misses %llu evictions %llu\n",
+		inst->dma_cache.nr, inst->dma_cache.hits,
+		inst->dma_cache.misses, inst->dma_cache.evictions);
+	mutex_unlock(&inst->dma_cache.lock);
+
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
 		dbuf, cur - dbuf);
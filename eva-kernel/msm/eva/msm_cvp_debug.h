@@ -66,6 +66,7 @@ extern bool msm_cvp_dsp_disable;
 extern bool msm_cvp_mmrm_enabled;
 extern bool msm_cvp_dcvs_disable;
 extern int msm_cvp_minidump_enable;
+extern int msm_cvp_fence_depth;
 
 #define dprintk(__level, __fmt, arg...)	\
 	do { \
@@ -71,15 +71,26 @@ exit:
 	return rc;
 }
 
+/*
+ * Responses carry no tag and are matched by type, so only one command is
+ * outstanding at a time. A response that arrives after its command timed
+ * out finds no command of its type pending and is dropped.
+ */
 static int cvp_dsp_send_cmd_sync(struct cvp_dsp_cmd_msg *cmd,
 		uint32_t len, struct cvp_dsp_rsp_msg *rsp)
 {
 	int rc = 0;
+	unsigned long flags;
 	struct cvp_dsp_apps *me = &gfa_cv;
 
 	dprintk(CVP_DSP, "%s: cmd = %d\n", __func__, cmd->type);
 
+	spin_lock_irqsave(&me->rsp_lock, flags);
+	memset(&me->pending_dsp2cpu_rsp, 0, sizeof(me->pending_dsp2cpu_rsp));
 	me->pending_dsp2cpu_rsp.type = cmd->type;
+	reinit_completion(&me->completions[cmd->type]);
+	spin_unlock_irqrestore(&me->rsp_lock, flags);
+
 	rc = cvp_dsp_send_cmd(cmd, len);
 	if (rc) {
 		dprintk(CVP_ERR, "%s: cvp_dsp_send_cmd failed rc=%d\n",
@@ -95,9 +106,11 @@ static int cvp_dsp_send_cmd_sync(struct cvp_dsp_cmd_msg *cmd,
 	}
 
 exit:
+	spin_lock_irqsave(&me->rsp_lock, flags);
 	rsp->ret = me->pending_dsp2cpu_rsp.ret;
 	rsp->dsp_state = me->pending_dsp2cpu_rsp.dsp_state;
 	me->pending_dsp2cpu_rsp.type = CVP_INVALID_RPMSG_TYPE;
+	spin_unlock_irqrestore(&me->rsp_lock, flags);
 	return rc;
 }
 
@@ -378,21 +391,24 @@ static int cvp_dsp_rpmsg_callback(struct rpmsg_device *rpdev,
 {
 	struct cvp_dsp_rsp_msg *rsp = (struct cvp_dsp_rsp_msg *)data;
 	struct cvp_dsp_apps *me = &gfa_cv;
+	unsigned long flags;
 
 	dprintk(CVP_DSP, "%s: type = 0x%x ret = 0x%x len = 0x%x\n",
 		__func__, rsp->type, rsp->ret, len);
 
 	if (rsp->type < CPU2DSP_MAX_CMD && len == sizeof(*rsp)) {
-		if (me->pending_dsp2cpu_rsp.type == rsp->type) {
-			memcpy(&me->pending_dsp2cpu_rsp, rsp,
-				sizeof(struct cvp_dsp_rsp_msg));
-			complete(&me->completions[rsp->type]);
-		} else {
-			dprintk(CVP_ERR, "%s: CPU2DSP resp %d, pending %d\n",
-					__func__, rsp->type,
-					me->pending_dsp2cpu_rsp.type);
-			goto exit;
+		spin_lock_irqsave(&me->rsp_lock, flags);
+		if (me->pending_dsp2cpu_rsp.type != rsp->type) {
+			spin_unlock_irqrestore(&me->rsp_lock, flags);
+			/* Late response of a command that timed out */
+			dprintk(CVP_WARN, "%s: drop CPU2DSP resp %d\n",
+					__func__, rsp->type);
+			return 0;
 		}
+		memcpy(&me->pending_dsp2cpu_rsp, rsp,
+			sizeof(struct cvp_dsp_rsp_msg));
+		complete(&me->completions[rsp->type]);
+		spin_unlock_irqrestore(&me->rsp_lock, flags);
 	} else if (rsp->type < CVP_DSP_MAX_CMD &&
 			len == sizeof(struct cvp_dsp2cpu_cmd_msg)) {
 		if (me->pending_dsp2cpu_cmd.type != CVP_INVALID_RPMSG_TYPE) {
@@ -526,133 +542,101 @@ exit:
 	return rc;
 }
 
-int cvp_dsp_register_buffer(uint32_t session_id, uint32_t buff_fd,
-			uint32_t buff_fd_size, uint32_t buff_size,
-			uint32_t buff_offset, uint32_t buff_index,
-			uint32_t buff_fd_iova)
+/* Maps a CPU2DSP response status to an errno, -EAGAIN asks for reinit */
+static int cvp_dsp_rsp_to_rc(struct cvp_dsp_rsp_msg *rsp)
 {
-	struct cvp_dsp_cmd_msg cmd;
-	int rc;
-	struct cvp_dsp_apps *me = &gfa_cv;
-	struct cvp_dsp_rsp_msg rsp;
-	bool retried = false;
+	switch (rsp->ret) {
+	case CPU2DSP_EFAIL:
+	case CPU2DSP_EUNSUPPORTED:
+		dprintk(CVP_WARN, "%s, DSP return err %d\n",
+			__func__, rsp->ret);
+		return -EINVAL;
+	case CPU2DSP_EUNAVAILABLE:
+		return -ENOTSUPP;
+	case CPU2DSP_EFATAL:
+		return -EAGAIN;
+	default:
+		return 0;
+	}
+}
 
-	cmd.type = CPU2DSP_REGISTER_BUFFER;
-	cmd.session_id = session_id;
-	cmd.buff_fd = buff_fd;
-	cmd.buff_fd_size = buff_fd_size;
-	cmd.buff_size = buff_size;
-	cmd.buff_offset = buff_offset;
-	cmd.buff_index = buff_index;
-	cmd.buff_fd_iova = buff_fd_iova;
+static void cvp_dsp_fill_buf_cmd(struct cvp_dsp_cmd_msg *cmd, uint32_t type,
+		uint32_t session_id, struct cvp_dsp_buf_desc *buf)
+{
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->type = type;
+	cmd->session_id = session_id;
+	cmd->buff_fd = buf->fd;
+	cmd->buff_fd_size = buf->fd_size;
+	cmd->buff_size = buf->size;
+	cmd->buff_offset = buf->offset;
+	cmd->buff_index = buf->index;
+	cmd->buff_fd_iova = buf->iova;
 
 	dprintk(CVP_DSP,
 		"%s: type=0x%x, buff_fd_iova=0x%x buff_index=0x%x\n",
-		__func__, cmd.type, buff_fd_iova,
-		cmd.buff_index);
+		__func__, cmd->type, cmd->buff_fd_iova,
+		cmd->buff_index);
 	dprintk(CVP_DSP, "%s: buff_size=0x%x session_id=0x%x\n",
-		__func__, cmd.buff_size, cmd.session_id);
-
-	mutex_lock(&me->tx_lock);
-retry:
-	rc = cvp_dsp_send_cmd_sync(&cmd, sizeof(struct cvp_dsp_cmd_msg), &rsp);
-	if (rc) {
-		dprintk(CVP_ERR, "%s send failed rc = %d\n", __func__, rc);
-		goto exit;
-	}
-
-	if (rsp.ret == CPU2DSP_EFAIL || rsp.ret == CPU2DSP_EUNSUPPORTED) {
-		dprintk(CVP_WARN, "%s, DSP return err %d\n", __func__, rsp.ret);
-		rc = -EINVAL;
-		goto exit;
-	}
-
-	if (rsp.ret == CPU2DSP_EUNAVAILABLE)
-		goto fatal_exit;
-
-	if (rsp.ret == CPU2DSP_EFATAL) {
-		if (!retried) {
-			mutex_unlock(&me->tx_lock);
-			retried = true;
-			rc = cvp_reinit_dsp();
-			mutex_lock(&me->tx_lock);
-			if (rc)
-				goto fatal_exit;
-			else
-				goto retry;
-		} else {
-			goto fatal_exit;
-		}
-	}
-
-	goto exit;
-
-fatal_exit:
-	me->state = DSP_INVALID;
-	cvp_hyp_assign_from_dsp();
-	rc = -ENOTSUPP;
-exit:
-	mutex_unlock(&me->tx_lock);
-	return rc;
+		__func__, cmd->buff_size, cmd->session_id);
 }
 
-int cvp_dsp_deregister_buffer(uint32_t session_id, uint32_t buff_fd,
-			uint32_t buff_fd_size, uint32_t buff_size,
-			uint32_t buff_offset, uint32_t buff_index,
-			uint32_t buff_fd_iova)
+/*
+ * Sends one register/deregister command per entry of @bufs under a single
+ * hold of tx_lock. A fatal DSP error reinitializes the DSP and resumes
+ * from the failing entry once, anything else fatal stops issuing.
+ */
+static int cvp_dsp_buffers_cmd(uint32_t type, uint32_t session_id,
+		struct cvp_dsp_buf_desc *bufs, uint32_t num_bufs)
 {
-	struct cvp_dsp_cmd_msg cmd;
-	int rc;
 	struct cvp_dsp_apps *me = &gfa_cv;
+	struct cvp_dsp_cmd_msg cmd;
 	struct cvp_dsp_rsp_msg rsp;
-	bool retried = false;
+	uint32_t i;
+	bool retried = false, need_retry;
+	int rc = 0;
 
-	cmd.type = CPU2DSP_DEREGISTER_BUFFER;
-	cmd.session_id = session_id;
-	cmd.buff_fd = buff_fd;
-	cmd.buff_fd_size = buff_fd_size;
-	cmd.buff_size = buff_size;
-	cmd.buff_offset = buff_offset;
-	cmd.buff_index = buff_index;
-	cmd.buff_fd_iova = buff_fd_iova;
+	if (!bufs || !num_bufs)
+		return -EINVAL;
 
-	dprintk(CVP_DSP,
-		"%s: type=0x%x, buff_fd_iova=0x%x buff_index=0x%x\n",
-		__func__, cmd.type, buff_fd_iova,
-		cmd.buff_index);
-	dprintk(CVP_DSP, "%s: buff_size=0x%x session_id=0x%x\n",
-		__func__, cmd.buff_size, cmd.session_id);
+	for (i = 0; i < num_bufs; i++)
+		bufs[i].rc = -EINPROGRESS;
 
 	mutex_lock(&me->tx_lock);
 retry:
-	rc = cvp_dsp_send_cmd_sync(&cmd, sizeof(struct cvp_dsp_cmd_msg), &rsp);
-	if (rc) {
-		dprintk(CVP_ERR, "%s send failed rc = %d\n", __func__, rc);
-		goto exit;
-	}
-
-	if (rsp.ret == CPU2DSP_EFAIL || rsp.ret == CPU2DSP_EUNSUPPORTED) {
-		dprintk(CVP_WARN, "%s, DSP return err %d\n", __func__, rsp.ret);
-		rc = -EINVAL;
-		goto exit;
+	need_retry = false;
+	for (i = 0; i < num_bufs; i++) {
+		if (bufs[i].rc != -EINPROGRESS)
+			continue;
+		cvp_dsp_fill_buf_cmd(&cmd, type, session_id, &bufs[i]);
+		rc = cvp_dsp_send_cmd_sync(&cmd, sizeof(cmd), &rsp);
+		if (rc) {
+			dprintk(CVP_ERR, "%s send failed rc = %d\n",
+				__func__, rc);
+		} else {
+			rc = cvp_dsp_rsp_to_rc(&rsp);
+		}
+		if (rc == -EAGAIN) {
+			need_retry = true;
+			break;
+		}
+		bufs[i].rc = rc;
+		if (rc == -ENOTSUPP)
+			goto fatal_exit;
 	}
 
-	if (rsp.ret == CPU2DSP_EUNAVAILABLE)
+	if (need_retry && retried)
 		goto fatal_exit;
 
-	if (rsp.ret == CPU2DSP_EFATAL) {
-		if (!retried) {
-			mutex_unlock(&me->tx_lock);
-			retried = true;
-			rc = cvp_reinit_dsp();
-			mutex_lock(&me->tx_lock);
-			if (rc)
-				goto fatal_exit;
-			else
-				goto retry;
-		} else {
+	if (need_retry) {
+		mutex_unlock(&me->tx_lock);
+		retried = true;
+		rc = cvp_reinit_dsp();
+		mutex_lock(&me->tx_lock);
+		if (rc)
 			goto fatal_exit;
-		}
+		else
+			goto retry;
 	}
 
 	goto exit;
@@ -660,12 +644,62 @@ retry:
 fatal_exit:
 	me->state = DSP_INVALID;
 	cvp_hyp_assign_from_dsp();
-	rc = -ENOTSUPP;
+	for (i = 0; i < num_bufs; i++) {
+		if (bufs[i].rc != -EINPROGRESS)
+			continue;
+		bufs[i].rc = -ENOTSUPP;
+	}
 exit:
 	mutex_unlock(&me->tx_lock);
+
+	rc = 0;
+	for (i = 0; i < num_bufs && !rc; i++)
+		rc = bufs[i].rc;
 	return rc;
 }
 
+int cvp_dsp_deregister_buffers(uint32_t session_id,
+			struct cvp_dsp_buf_desc *bufs, uint32_t num_bufs)
+{
+	return cvp_dsp_buffers_cmd(CPU2DSP_DEREGISTER_BUFFER, session_id,
+			bufs, num_bufs);
+}
+
+int cvp_dsp_register_buffer(uint32_t session_id, uint32_t buff_fd,
+			uint32_t buff_fd_size, uint32_t buff_size,
+			uint32_t buff_offset, uint32_t buff_index,
+			uint32_t buff_fd_iova)
+{
+	struct cvp_dsp_buf_desc buf = {
+		.fd = buff_fd,
+		.fd_size = buff_fd_size,
+		.size = buff_size,
+		.offset = buff_offset,
+		.index = buff_index,
+		.iova = buff_fd_iova,
+	};
+
+	return cvp_dsp_buffers_cmd(CPU2DSP_REGISTER_BUFFER, session_id,
+			&buf, 1);
+}
+
+int cvp_dsp_deregister_buffer(uint32_t session_id, uint32_t buff_fd,
+			uint32_t buff_fd_size, uint32_t buff_size,
+			uint32_t buff_offset, uint32_t buff_index,
+			uint32_t buff_fd_iova)
+{
+	struct cvp_dsp_buf_desc buf = {
+		.fd = buff_fd,
+		.fd_size = buff_fd_size,
+		.size = buff_size,
+		.offset = buff_offset,
+		.index = buff_index,
+		.iova = buff_fd_iova,
+	};
+
+	return cvp_dsp_deregister_buffers(session_id, &buf, 1);
+}
+
 static const struct rpmsg_device_id cvp_dsp_rpmsg_match[] = {
 	{ CVP_APPS_DSP_GLINK_GUID },
 	{ },
@@ -1967,6 +2001,7 @@ int cvp_dsp_device_init(void)
 
 	me->pending_dsp2cpu_cmd.type = CVP_INVALID_RPMSG_TYPE;
 	me->pending_dsp2cpu_rsp.type = CVP_INVALID_RPMSG_TYPE;
+	spin_lock_init(&me->rsp_lock);
 
 	INIT_MSM_CVP_LIST(&me->fastrpc_driver_list);
 
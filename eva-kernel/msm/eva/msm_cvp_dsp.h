@@ -143,6 +143,20 @@ struct cvp_dsp_rsp_msg {
 	uint32_t reserved[CVP_DSP_MAX_RESERVED - 1];
 };
 
+/*
+ * Buffer entry of a vector deregister request.
+ * @rc is filled in with the result of the entry on completion.
+ */
+struct cvp_dsp_buf_desc {
+	uint32_t fd;
+	uint32_t fd_size;
+	uint32_t size;
+	uint32_t offset;
+	uint32_t index;
+	uint32_t iova;
+	int rc;
+};
+
 struct cvp_dsp2cpu_cmd_msg {
 	uint32_t type;
 	uint32_t ver;
@@ -206,6 +220,8 @@ struct cvp_dsp_apps {
 	struct completion completions[CPU2DSP_MAX_CMD + 1];
 	struct cvp_dsp2cpu_cmd_msg pending_dsp2cpu_cmd;
 	struct cvp_dsp_rsp_msg pending_dsp2cpu_rsp;
+	/* rsp_lock protects pending_dsp2cpu_rsp against the rpmsg callback */
+	spinlock_t rsp_lock;
 	struct task_struct *dsp_thread;
 	/* dsp buffer mapping, set of dma function pointer */
 	const struct file_operations *dmabuf_f_op;
@@ -274,6 +290,19 @@ int cvp_dsp_deregister_buffer(uint32_t session_id, uint32_t buff_fd,
 			uint32_t buff_offset, uint32_t buff_index,
 			uint32_t buff_fd_iova);
 
+/*
+ * API to de-register a vector of iova buffers from CDSP. The entries are
+ * sent one at a time under a single hold of tx_lock.
+ *
+ * @session_id:     cvp session id
+ * @bufs:           buffers, bufs[i].rc holds the result of each entry
+ * @num_bufs:       number of entries in @bufs
+ *
+ * Returns 0 if every entry succeeded, else the first error.
+ */
+int cvp_dsp_deregister_buffers(uint32_t session_id,
+			struct cvp_dsp_buf_desc *bufs, uint32_t num_bufs);
+
 int cvp_dsp_fastrpc_unmap(uint32_t process_id, struct cvp_internal_buf *buf);
 
 int cvp_dsp_del_sess(uint32_t process_id, struct msm_cvp_inst *inst);
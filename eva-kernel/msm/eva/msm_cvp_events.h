@@ -358,6 +358,37 @@ DEFINE_EVENT(msm_cvp_perf, msm_cvp_perf_bus_vote,
 	TP_ARGS(governor_mode, ab)
 );
 
+TRACE_EVENT(msm_cvp_power_update,
+
+	TP_PROTO(void *instp, unsigned long core_sum, unsigned long bw_sum,
+		bool clk_voted, bool bus_voted),
+
+	TP_ARGS(instp, core_sum, bw_sum, clk_voted, bus_voted),
+
+	TP_STRUCT__entry(
+		__field(void *, instp)
+		__field(unsigned long, core_sum)
+		__field(unsigned long, bw_sum)
+		__field(bool, clk_voted)
+		__field(bool, bus_voted)
+	),
+
+	TP_fast_assign(
+		__entry->instp = instp;
+		__entry->core_sum = core_sum;
+		__entry->bw_sum = bw_sum;
+		__entry->clk_voted = clk_voted;
+		__entry->bus_voted = bus_voted;
+	),
+
+	TP_printk("inst %p core_sum %lu bw_sum %lu clk_voted %d bus_voted %d",
+		__entry->instp,
+		__entry->core_sum,
+		__entry->bw_sum,
+		__entry->clk_voted,
+		__entry->bus_voted)
+);
+
 #endif
 
 #include <trace/define_trace.h>
@@ -15,6 +15,7 @@
 #include <linux/workqueue.h>
 #include <linux/interconnect.h>
 #include <linux/kref.h>
+#include <linux/hashtable.h>
 #include <linux/cdev.h>
 #include <linux/slab.h>
 #include <linux/kthread.h>
@@ -31,6 +32,7 @@
 #define FENCE_WAIT_SIGNAL_TIMEOUT 100
 #define FENCE_WAIT_SIGNAL_RETRY_TIMES 20
 #define FENCE_BIT (1ULL << 63)
+#define CVP_FRAME_HASH_BITS 6
 
 #define FENCE_DMM_ICA_ENABLED_IDX 0
 #define FENCE_DMM_DS_IDX 1
@@ -212,12 +214,19 @@ struct cvp_session_msg {
 	struct cvp_hfi_msg_session_hdr_ext pkt;
 };
 
+/*
+ * msg_total and max_msg_count track queued responses, wakeups counts the
+ * times a waiter checked the queue, all under lock.
+ */
 struct cvp_session_queue {
 	spinlock_t lock;
 	enum queue_state state;
 	unsigned int msg_count;
 	struct list_head msgs;
 	wait_queue_head_t wq;
+	unsigned int max_msg_count;
+	u64 msg_total;
+	u64 wakeups;
 };
 
 #define CVP_CYCLE_STAT_SIZE		8
@@ -236,6 +245,46 @@ struct cvp_cycle_info {
 	unsigned long conf_freq;
 };
 
+enum cvp_power_blk {
+	CVP_PWR_FDU,
+	CVP_PWR_OD,
+	CVP_PWR_MPU,
+	CVP_PWR_ICA,
+	CVP_PWR_FW,
+	CVP_PWR_BLK_MAX
+};
+
+/* Class 0 aggregates non-realtime sessions, class 1 realtime sessions */
+#define CVP_PWR_CLASS_MAX 2
+
+/* Profile a session last added to the core power aggregate */
+struct cvp_power_contrib {
+	bool valid;
+	u32 cls;
+	u32 cycles[CVP_PWR_BLK_MAX];
+	u32 op_cycles[CVP_PWR_BLK_MAX];
+	u32 bw;
+	u32 op_bw;
+	u32 fps[HFI_MAX_HW_THREADS];
+};
+
+/*
+ * Running per-class sums of all session contributions. Maxima are only
+ * recomputed from the session list when the session holding one of them
+ * lowers its profile or leaves (max_stale). Protected by core->clk_lock.
+ */
+struct cvp_power_aggr {
+	unsigned long cycles[CVP_PWR_CLASS_MAX][CVP_PWR_BLK_MAX];
+	unsigned long op_max[CVP_PWR_CLASS_MAX][CVP_PWR_BLK_MAX];
+	unsigned long bw[CVP_PWR_CLASS_MAX];
+	unsigned long op_bw_max[CVP_PWR_CLASS_MAX];
+	bool max_stale[CVP_PWR_CLASS_MAX];
+	u32 nr_updates;
+	u32 nr_rescans;
+	u32 nr_clk_votes;
+	u32 nr_bus_votes;
+};
+
 struct cvp_session_prop {
 	u32 type;
 	u32 kernel_mask;
@@ -369,6 +418,7 @@ struct msm_cvp_core {
 	unsigned long curr_freq;
 	unsigned long orig_core_sum;
 	struct cvp_cycle_info dyn_clk;
+	struct cvp_power_aggr pwr_aggr;
 	atomic64_t kernel_trans_id;
 	struct cvp_debug_log log;
 };
@@ -391,6 +441,8 @@ struct msm_cvp_inst {
 	struct cvp_dmamap_cache dma_cache;
 	struct msm_cvp_list cvpdspbufs;
 	struct msm_cvp_list frames;
+	/* frames indexed by ktid, protected by frames.lock */
+	DECLARE_HASHTABLE(frame_hash, CVP_FRAME_HASH_BITS);
 	struct completion completions[SESSION_MSG_END - SESSION_MSG_START + 1];
 	struct dentry *debugfs_root;
 	struct msm_cvp_debug debug;
@@ -399,6 +451,7 @@ struct msm_cvp_inst {
 	struct msm_cvp_capability capability;
 	struct kref kref;
 	struct cvp_session_prop prop;
+	struct cvp_power_contrib pwr_contrib;
 	/* error_code will be cleared after being returned to user mode */
 	u32 error_code;
 	/* prev_error_code saves value of error_code before it's cleared */
@@ -78,6 +78,7 @@ struct bus_info {
 	struct devfreq *devfreq;
 	struct icc_path *client;
 	bool is_prfm_gov_used;
+	unsigned long voted_bw;
 };
 
 struct bus_set {
@@ -11,6 +11,12 @@
 #include "cvp_comm_def.h"
 
 
+/*
+ * Fence commands move from wait_list to sched_list when a fence thread
+ * picks them up and stay there until their output fences are signaled.
+ * inflight counts the commands on sched_list, fence threads stop picking
+ * up new commands while it is at depth.
+ */
 struct cvp_fence_queue {
 	struct mutex lock;
 	enum queue_state state;
@@ -18,6 +24,8 @@ struct cvp_fence_queue {
 	struct list_head wait_list;
 	wait_queue_head_t wq;
 	struct list_head sched_list;
+	u32 inflight;
+	u32 depth;
 };
 
 struct cvp_fence_type {
@@ -35,6 +43,9 @@ struct cvp_fence_command {
 	u32 type;
 	u32 synx[MAX_HFI_FENCE_SIZE/2];
 	struct cvp_hfi_cmd_session_hdr *pkt;
+	bool submitted;
+	bool in_submit;
+	unsigned long submit_time;
 };
 
 enum cvp_synx_type {
@@ -35,6 +35,11 @@ static int mmrm_sw_vdd_corner[] = {
 };
 
 #define MMRM_SW_CLIENTS_NUM_MAX 35
+#define MMRM_SW_MAX_RATE_PLAN 32
+/* throttling cost weight of a high priority client */
+#define MMRM_SW_THROTTLE_WEIGHT_HIGH 4
+/* headroom below threshold, in percent, before reinstating a client */
+#define MMRM_SW_REINSTATE_HYST_PCT 5
 extern u8 msm_mmrm_enable_throttle_feature;
 typedef int (*notifier_callback_fn_t)(
 	struct mmrm_client_notifier_data *notifier_data);
@@ -56,6 +61,10 @@ struct mmrm_sw_clk_client_tbl_entry {
 	u32 dyn_pwr[MMRM_VDD_LEVEL_MAX];
 	u32 leak_pwr[MMRM_VDD_LEVEL_MAX];
 	u32 current_ma[MMRM_VDD_LEVEL_MAX][MMRM_VDD_LEVEL_MAX];
+	/* discrete clk rates in ascending order and their vdd level */
+	u32 num_rates;
+	u64 rate_plan[MMRM_SW_MAX_RATE_PLAN];
+	u32 rate_level[MMRM_SW_MAX_RATE_PLAN];
 
 	/* reference to this entry */
 	struct mmrm_client *client;
@@ -75,6 +84,14 @@ struct mmrm_sw_throttled_clients_data {
 	u32 prev_vdd_level;
 };
 
+struct mmrm_sw_throttle_candidate {
+	u32 table_id;
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry;
+	/* current saved by throttling to low svs and saving per weight */
+	u32 saving_ma;
+	u32 score;
+};
+
 struct mmrm_sw_peak_current_data {
 	/* peak current data in ma */
 	u32 threshold;
@@ -82,6 +99,12 @@ struct mmrm_sw_peak_current_data {
 	u32 aggreg_val;
 	/* mmcx voltage level */
 	u32 aggreg_level;
+	/*
+	 * running totals over enabled clients: current in ma if mmcx ran
+	 * at each level, and number of clients voting each level
+	 */
+	u32 level_cur_ma[MMRM_VDD_LEVEL_MAX];
+	u32 level_clients[MMRM_VDD_LEVEL_MAX];
 };
 
 struct mmrm_throttle_info {
@@ -104,6 +127,10 @@ struct mmrm_sw_clk_mgr_info {
 
 	/* HEAD of list of clients throttled */
 	struct list_head throttled_clients;
+	/* throttle events, clients on throttled_clients, reinstates */
+	u32 throttle_cnt;
+	u32 throttled_clients_cnt;
+	u32 reinstate_cnt;
 
 };
 
@@ -13,18 +13,89 @@
 
 #define Q16_INT(q) ((q) >> 16)
 #define Q16_FRAC(q) ((((q) & 0xFFFF) * 100) >> 16)
-#define CLK_RATE_STEP 1000000
 #define NOTIFY_TIMEOUT 100000000
 
+/* Maps a voltage corner to a vdd level, corners below low svs are low svs */
+static int mmrm_sw_corner_to_level(int voltage_corner, u32 *level)
+{
+	u32 i;
+
+	if (voltage_corner < 0 ||
+		voltage_corner > mmrm_sw_vdd_corner[MMRM_VDD_LEVEL_TURBO])
+		return -EINVAL;
+
+	if (voltage_corner < mmrm_sw_vdd_corner[MMRM_VDD_LEVEL_LOW_SVS]) {
+		*level = MMRM_VDD_LEVEL_LOW_SVS;
+		return 0;
+	}
+
+	for (i = 0; i < MMRM_VDD_LEVEL_MAX; i++) {
+		if (voltage_corner == mmrm_sw_vdd_corner[i])
+			break;
+	}
+	*level = i;
+
+	return 0;
+}
+
+/*
+ * Returns the lowest rate of the clk plan above @rate, or @rate if there is
+ * none up to @max_rate. Rates are probed at growing distances and the gap
+ * is then bisected, so only a few round_rate calls are needed per rate
+ * whether the clk rounds requests up or down.
+ */
+static long mmrm_sw_next_rate(struct clk *clk, long rate, long max_rate)
+{
+	long lo = rate, hi, step = 1;
+
+	hi = rate + step;
+	while (clk_round_rate(clk, hi) <= rate) {
+		if (hi >= max_rate)
+			return rate;
+		lo = hi;
+		step <<= 1;
+		hi = (max_rate - rate > step) ? rate + step : max_rate;
+	}
+
+	/* round(lo) <= rate < round(hi) */
+	while (hi - lo > 1) {
+		long mid = lo + ((hi - lo) >> 1);
+
+		if (clk_round_rate(clk, mid) > rate)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	return clk_round_rate(clk, hi);
+}
+
+static void mmrm_sw_add_rate_plan(struct mmrm_sw_clk_client_tbl_entry *tbl_entry,
+	long clk_val, u32 level)
+{
+	if (level >= MMRM_VDD_LEVEL_MAX)
+		return;
+
+	if (tbl_entry->num_rates >= MMRM_SW_MAX_RATE_PLAN) {
+		d_mpr_h("%s: csid(0x%x): rate plan full at clk_rate(%llu)\n",
+			__func__, tbl_entry->clk_src_id, clk_val);
+		return;
+	}
+
+	tbl_entry->rate_plan[tbl_entry->num_rates] = clk_val;
+	tbl_entry->rate_level[tbl_entry->num_rates] = level;
+	tbl_entry->num_rates++;
+}
+
 static int mmrm_sw_update_freq(
 	struct mmrm_sw_clk_mgr_info *sinfo, struct mmrm_sw_clk_client_tbl_entry *tbl_entry)
 {
 	int rc = 0;
-	u32 i;
+	u32 i, level;
 	struct mmrm_driver_data *drv_data = (struct mmrm_driver_data *)sinfo->driver_data;
 	struct mmrm_clk_platform_resources *cres = &drv_data->clk_res;
 	struct voltage_corner_set *cset = &cres->corner_set;
-	long clk_val_min, clk_val_max, clk_val, clk_val_round;
+	long clk_val_min, clk_val_max, clk_val_round;
 	int voltage_corner;
 
 	clk_val_min = clk_round_rate(tbl_entry->clk, 1);
@@ -40,34 +111,30 @@ static int mmrm_sw_update_freq(
 		tbl_entry->freq[i] = clk_val_min;
 	}
 
-	/* step through rates */
-	for (clk_val = clk_val_min; clk_val < clk_val_max; clk_val += CLK_RATE_STEP) {
-		/* get next clk rate */
-		clk_val_round = clk_round_rate(tbl_entry->clk, clk_val);
-		if (clk_val_round > clk_val_min) {
-			clk_val_min = clk_val_round;
+	tbl_entry->num_rates = 0;
+	voltage_corner = qcom_clk_get_voltage(tbl_entry->clk, clk_val_min);
+	if (!mmrm_sw_corner_to_level(voltage_corner, &level))
+		mmrm_sw_add_rate_plan(tbl_entry, clk_val_min, level);
 
-			/* Get voltage corner */
-			voltage_corner = qcom_clk_get_voltage(tbl_entry->clk, clk_val_round);
-			if (voltage_corner < 0 || voltage_corner > mmrm_sw_vdd_corner[MMRM_VDD_LEVEL_TURBO]) {
-				break;
-			}
+	/* walk the discrete rates of the clk */
+	while (clk_val_min < clk_val_max) {
+		/* get next clk rate */
+		clk_val_round = mmrm_sw_next_rate(tbl_entry->clk,
+			clk_val_min, clk_val_max);
+		if (clk_val_round <= clk_val_min)
+			break;
+		clk_val_min = clk_val_round;
 
-			/* voltage corner is below svsl1 */
-			if (voltage_corner < mmrm_sw_vdd_corner[MMRM_VDD_LEVEL_LOW_SVS])
-				voltage_corner = mmrm_sw_vdd_corner[MMRM_VDD_LEVEL_LOW_SVS];
+		/* Get voltage corner */
+		voltage_corner = qcom_clk_get_voltage(tbl_entry->clk, clk_val_round);
+		if (mmrm_sw_corner_to_level(voltage_corner, &level))
+			break;
 
-			/* match vdd level */
-			for (i = 0; i < MMRM_VDD_LEVEL_MAX; i++) {
-				if (voltage_corner == mmrm_sw_vdd_corner[i])
-					break;
-			}
+		mmrm_sw_add_rate_plan(tbl_entry, clk_val_round, level);
 
-			/* update freq */
-			while (i < MMRM_VDD_LEVEL_MAX) {
-				tbl_entry->freq[i++] = clk_val_round;
-			}
-		}
+		/* update freq */
+		for (i = level; i < MMRM_VDD_LEVEL_MAX; i++)
+			tbl_entry->freq[i] = clk_val_round;
 	}
 
 	/* print results */
@@ -78,6 +145,8 @@ static int mmrm_sw_update_freq(
 			cset->corner_tbl[i].name,
 			tbl_entry->freq[i]);
 	}
+	d_mpr_h("%s: csid(0x%x) num_rates(%d)\n",
+		__func__, tbl_entry->clk_src_id, tbl_entry->num_rates);
 
 	return rc;
 }
@@ -302,6 +371,41 @@ err_already_registered:
 	return NULL;
 }
 
+static inline bool mmrm_sw_client_enabled(
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry)
+{
+	return !IS_ERR_OR_NULL(tbl_entry->clk) && tbl_entry->clk_rate;
+}
+
+/*
+ * Adds or removes the contribution of an enabled client to the per-level
+ * totals. Must bracket every change of clk, clk_rate, vdd_level or
+ * num_hw_blocks of an entry, with the clk mgr lock held.
+ */
+static void mmrm_sw_account_client(struct mmrm_sw_clk_mgr_info *sinfo,
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry, bool add)
+{
+	struct mmrm_sw_peak_current_data *peak_data = &sinfo->peak_cur_data;
+	u32 level, cur;
+
+	if (!mmrm_sw_client_enabled(tbl_entry))
+		return;
+
+	for (level = 0; level < MMRM_VDD_LEVEL_MAX; level++) {
+		cur = tbl_entry->current_ma[tbl_entry->vdd_level][level] *
+			tbl_entry->num_hw_blocks;
+		if (add)
+			peak_data->level_cur_ma[level] += cur;
+		else
+			peak_data->level_cur_ma[level] -= cur;
+	}
+
+	if (add)
+		peak_data->level_clients[tbl_entry->vdd_level]++;
+	else
+		peak_data->level_clients[tbl_entry->vdd_level]--;
+}
+
 static int mmrm_sw_clk_client_deregister(struct mmrm_clk_mgr *sw_clk_mgr,
 	struct mmrm_client *client)
 {
@@ -332,6 +436,7 @@ static int mmrm_sw_clk_client_deregister(struct mmrm_clk_mgr *sw_clk_mgr,
 
 	if (tbl_entry->ref_count == 0) {
 
+		mmrm_sw_account_client(sinfo, tbl_entry, false);
 		kfree(tbl_entry->client);
 		tbl_entry->vdd_level = 0;
 		tbl_entry->clk_rate = 0;
@@ -351,6 +456,28 @@ err_invalid_client:
 	return rc;
 }
 
+/* Binary search of the rate plan, only exact rates are resolved here */
+static int mmrm_sw_lookup_rate_plan(
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry,
+	unsigned long clk_val, u32 *req_level)
+{
+	u32 lo = 0, hi = tbl_entry->num_rates, mid;
+
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1);
+		if (tbl_entry->rate_plan[mid] < clk_val)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == tbl_entry->num_rates || tbl_entry->rate_plan[lo] != clk_val)
+		return -ENOENT;
+
+	*req_level = tbl_entry->rate_level[lo];
+	return 0;
+}
+
 static int mmrm_sw_get_req_level(
 	struct mmrm_sw_clk_client_tbl_entry *tbl_entry,
 	unsigned long clk_val, u32 *req_level)
@@ -359,7 +486,13 @@ static int mmrm_sw_get_req_level(
 	int voltage_corner;
 	u32 level;
 
-	/* get voltage corner */
+	if (!mmrm_sw_lookup_rate_plan(tbl_entry, clk_val, &level)) {
+		*req_level = level;
+		d_mpr_h("%s: req_level(%d)\n", __func__, level);
+		goto exit_no_err;
+	}
+
+	/* rate not in the plan, get voltage corner */
 	voltage_corner = qcom_clk_get_voltage(tbl_entry->clk, clk_val);
 	if (voltage_corner < 0 || voltage_corner > mmrm_sw_vdd_corner[MMRM_VDD_LEVEL_TURBO]) {
 		d_mpr_e("%s: csid(0x%x): invalid voltage corner(%d) for clk rate(%llu)\n",
@@ -409,13 +542,12 @@ err_invalid_corner:
 
 static int mmrm_sw_check_req_level(
 	struct mmrm_sw_clk_mgr_info *sinfo,
-	u32 clk_src_id, u32 req_level, u32 *adj_level)
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry,
+	u32 req_level, u32 *adj_level)
 {
 	int rc = 0;
 	struct mmrm_sw_peak_current_data *peak_data = &sinfo->peak_cur_data;
-	struct mmrm_sw_clk_client_tbl_entry *tbl_entry = NULL;
-	struct mmrm_sw_clk_client_tbl_entry *next_max_entry = NULL;
-	u32 c, level = req_level;
+	u32 level = req_level, l, nr_clients;
 
 	if (req_level >= MMRM_VDD_LEVEL_MAX) {
 		d_mpr_e("%s: invalid level %lu\n", __func__, req_level);
@@ -423,30 +555,23 @@ static int mmrm_sw_check_req_level(
 		goto err_invalid_level;
 	}
 	d_mpr_h("%s: csid(0x%x) level(%d) peak_data->aggreg_level(%d)\n",
-		__func__, clk_src_id, level, peak_data->aggreg_level);
+		__func__, tbl_entry->clk_src_id, level,
+		peak_data->aggreg_level);
 
-	/* req_level is rejected when another client has a higher level */
+	/*
+	 * req_level is raised to the highest level voted by another client,
+	 * found from the per-level client counts excluding this client
+	 */
 	if (req_level < peak_data->aggreg_level) {
-		for (c = 0; c < sinfo->tot_clk_clients; c++) {
-			tbl_entry = &sinfo->clk_client_tbl[c];
-			if (IS_ERR_OR_NULL(tbl_entry->clk) || !tbl_entry->clk_rate ||
-				(tbl_entry->clk_src_id == clk_src_id)) {
-				continue;
-			}
-			if (tbl_entry->vdd_level == peak_data->aggreg_level) {
+		for (l = peak_data->aggreg_level; l > req_level; l--) {
+			nr_clients = peak_data->level_clients[l];
+			if (mmrm_sw_client_enabled(tbl_entry) &&
+				tbl_entry->vdd_level == l)
+				nr_clients--;
+			if (nr_clients) {
+				level = l;
 				break;
 			}
-			if  ((tbl_entry->vdd_level < peak_data->aggreg_level)
-					&& (tbl_entry->vdd_level > req_level ))
-				next_max_entry = tbl_entry;
-
-		}
-		/* reject req level */
-		if (c < sinfo->tot_clk_clients) {
-			level = peak_data->aggreg_level;
-		} else if (!IS_ERR_OR_NULL(next_max_entry)
-			&& next_max_entry->vdd_level > req_level) {
-			level = next_max_entry->vdd_level;
 		}
 	}
 
@@ -463,8 +588,7 @@ static int mmrm_sw_calculate_total_current(
 	u32 req_level, u32 *total_cur, struct mmrm_sw_clk_client_tbl_entry *tbl_entry_new)
 {
 	int rc = 0;
-	struct mmrm_sw_clk_client_tbl_entry *tbl_entry;
-	u32 c, sum_cur = 0;
+	u32 sum_cur;
 
 	if (req_level >= MMRM_VDD_LEVEL_MAX) {
 		d_mpr_e("%s: invalid level %lu\n", __func__, req_level);
@@ -472,16 +596,11 @@ static int mmrm_sw_calculate_total_current(
 		goto err_invalid_level;
 	}
 
-	/* calculate sum of values (scaled by volt) */
-	for (c = 0; c < sinfo->tot_clk_clients; c++) {
-		tbl_entry = &sinfo->clk_client_tbl[c];
-		if (IS_ERR_OR_NULL(tbl_entry->clk) || !tbl_entry->clk_rate
-			|| (tbl_entry == tbl_entry_new)) {
-			continue;
-		}
-		sum_cur += (tbl_entry->current_ma[tbl_entry->vdd_level][req_level]
-			* tbl_entry->num_hw_blocks);
-	}
+	/* running sum of values (scaled by volt) without the new entry */
+	sum_cur = sinfo->peak_cur_data.level_cur_ma[req_level];
+	if (mmrm_sw_client_enabled(tbl_entry_new))
+		sum_cur -= tbl_entry_new->current_ma[tbl_entry_new->vdd_level]
+			[req_level] * tbl_entry_new->num_hw_blocks;
 
 	*total_cur = sum_cur;
 	d_mpr_h("%s: total_cur(%lu)\n", __func__, *total_cur);
@@ -491,57 +610,108 @@ err_invalid_level:
 	return rc;
 }
 
+static u32 mmrm_sw_throttle_weight(struct mmrm_sw_clk_client_tbl_entry *tbl_entry)
+{
+	return (tbl_entry->pri == MMRM_CLIENT_PRIOR_HIGH) ?
+		MMRM_SW_THROTTLE_WEIGHT_HIGH : 1;
+}
+
+/*
+ * Collect throttle candidates sorted by saving per unit of priority weight,
+ * best first, and pick the set to throttle: the best single client covering
+ * delta_cur if there is one, else the shortest prefix that covers it.
+ * Returns the number of clients picked, 0 if delta_cur can't be covered.
+ */
+static u32 mmrm_sw_pick_throttle_set(struct mmrm_sw_clk_mgr_info *sinfo,
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry_req, int delta_cur,
+	struct mmrm_sw_throttle_candidate *cand)
+{
+	struct mmrm_sw_peak_current_data *peak_data = &sinfo->peak_cur_data;
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry;
+	struct mmrm_sw_throttle_candidate tmp;
+	u32 now_cur_ma, min_cur_ma, sum_cur = 0;
+	u32 i, j, num = 0;
+
+	for (i = 0; i < sinfo->throttle_clients_data_length; i++) {
+		tbl_entry = &sinfo->clk_client_tbl
+			[sinfo->throttle_clients_info[i].tbl_entry_id];
+		if (tbl_entry == tbl_entry_req || !mmrm_sw_client_enabled(tbl_entry))
+			continue;
+
+		now_cur_ma = tbl_entry->current_ma[tbl_entry->vdd_level]
+			[peak_data->aggreg_level];
+		min_cur_ma = tbl_entry->current_ma[MMRM_VDD_LEVEL_LOW_SVS]
+			[peak_data->aggreg_level];
+
+		d_mpr_h("%s: csid(0x%x) name(%s) now_cur_ma(%u) min_cur_ma(%u)\n",
+			__func__, tbl_entry->clk_src_id, tbl_entry->name,
+			now_cur_ma, min_cur_ma);
+
+		if (now_cur_ma <= min_cur_ma)
+			continue;
+
+		tmp.table_id = i;
+		tmp.tbl_entry = tbl_entry;
+		tmp.saving_ma = now_cur_ma - min_cur_ma;
+		tmp.score = tmp.saving_ma / mmrm_sw_throttle_weight(tbl_entry);
+
+		/* insertion keeps the few candidates ordered by score */
+		for (j = num; j > 0 && cand[j - 1].score < tmp.score; j--)
+			cand[j] = cand[j - 1];
+		cand[j] = tmp;
+		num++;
+	}
+
+	for (i = 0; i < num; i++) {
+		if ((signed)cand[i].saving_ma > delta_cur) {
+			cand[0] = cand[i];
+			return 1;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		sum_cur += cand[i].saving_ma;
+		if ((signed)sum_cur > delta_cur)
+			return i + 1;
+	}
+
+	return 0;
+}
+
 static int mmrm_sw_throttle_low_priority_client(
-	struct mmrm_sw_clk_mgr_info *sinfo, int *delta_cur)
+	struct mmrm_sw_clk_mgr_info *sinfo,
+	struct mmrm_sw_clk_client_tbl_entry *tbl_entry_req, int *delta_cur)
 {
-	int rc = 0, i;
+	int rc = 0;
+	u32 i, num, saved_ma = 0;
 	u64 start_ts = 0, end_ts = 0;
-	bool found_client_throttle = false;
 	struct mmrm_sw_clk_client_tbl_entry *tbl_entry_throttle_client;
 	struct mmrm_client_notifier_data notifier_data;
-	struct completion timeout;
 	struct mmrm_sw_peak_current_data *peak_data = &sinfo->peak_cur_data;
 	struct mmrm_sw_throttled_clients_data *tc_data;
-
-	u32 now_cur_ma, min_cur_ma;
+	struct mmrm_sw_throttle_candidate cand[MMRM_MAX_THROTTLE_CLIENTS];
 	long clk_min_level = MMRM_VDD_LEVEL_LOW_SVS;
 
-	init_completion(&timeout);
-
-	for (i = 0; i < sinfo->throttle_clients_data_length ; i++) {
-		tbl_entry_throttle_client =
-			&sinfo->clk_client_tbl[sinfo->throttle_clients_info[i].tbl_entry_id];
-		if (!IS_ERR_OR_NULL(tbl_entry_throttle_client)) {
-			now_cur_ma = tbl_entry_throttle_client->current_ma
-				[tbl_entry_throttle_client->vdd_level]
-				[peak_data->aggreg_level];
-			min_cur_ma = tbl_entry_throttle_client->current_ma[clk_min_level]
-				[peak_data->aggreg_level];
-
-			d_mpr_h("%s:csid(0x%x) name(%s)\n",
-				__func__, tbl_entry_throttle_client->clk_src_id,
-				tbl_entry_throttle_client->name);
-			d_mpr_h("%s:now_cur_ma(%llu) min_cur_ma(%llu) delta_cur(%d)\n",
-				__func__, now_cur_ma, min_cur_ma, *delta_cur);
-
-			if ((now_cur_ma > min_cur_ma)
-				&& (now_cur_ma - min_cur_ma > *delta_cur)) {
-				found_client_throttle = true;
-				d_mpr_h("%s: Throttle client csid(0x%x) name(%s)\n",
-					__func__, tbl_entry_throttle_client->clk_src_id,
-					tbl_entry_throttle_client->name);
-				d_mpr_h("%s:now_cur_ma %llu-min_cur_ma %llu>delta_cur %d\n",
-					__func__, now_cur_ma, min_cur_ma, *delta_cur);
-				/* found client to throttle, break from here. */
-				break;
-			}
+	num = mmrm_sw_pick_throttle_set(sinfo, tbl_entry_req, *delta_cur, cand);
+	d_mpr_h("%s: throttling %u clients for delta_cur(%d)\n",
+		__func__, num, *delta_cur);
+
+	/* Throttle the picked clients to minimum clock rate in one pass */
+	for (i = 0; i < num; i++) {
+		tbl_entry_throttle_client = cand[i].tbl_entry;
+		d_mpr_h("%s: Throttle client csid(0x%x) name(%s) saving(%u)\n",
+			__func__, tbl_entry_throttle_client->clk_src_id,
+			tbl_entry_throttle_client->name, cand[i].saving_ma);
+
+		/* Bookkeeping is allocated first so a throttle is never lost */
+		tc_data = kzalloc(sizeof(*tc_data), GFP_KERNEL);
+		if (IS_ERR_OR_NULL(tc_data)) {
+			d_mpr_e("%s: Failed to allocate memory\n", __func__);
+			rc = -ENOMEM;
+			goto err_clk_set_fail;
 		}
-	}
 
-	/*Client to throttle is found, Throttle this client now to minimum clock rate*/
-	if (found_client_throttle) {
 		/* Setup notifier */
-
 		notifier_data.cb_type = MMRM_CLIENT_RESOURCE_VALUE_CHANGE;
 		notifier_data.cb_data.val_chng.old_val =
 			tbl_entry_throttle_client->freq[tbl_entry_throttle_client->vdd_level];
@@ -560,6 +730,7 @@ static int mmrm_sw_throttle_low_priority_client(
 		if (rc) {
 			d_mpr_e("%s: Client failed to send SUCCESS in callback(%d)\n",
 				__func__, tbl_entry_throttle_client->clk_src_id);
+			kfree(tc_data);
 			rc = -EINVAL;
 			goto err_clk_set_fail;
 		}
@@ -574,6 +745,7 @@ static int mmrm_sw_throttle_low_priority_client(
 			if (rc) {
 				d_mpr_e("%s: Failed to throttle the clk csid(%d)\n",
 					__func__, tbl_entry_throttle_client->clk_src_id);
+				kfree(tc_data);
 				rc = -EINVAL;
 				goto err_clk_set_fail;
 			}
@@ -582,19 +754,18 @@ static int mmrm_sw_throttle_low_priority_client(
 		d_mpr_h("%s: %s throttled to %llu\n",
 			__func__, tbl_entry_throttle_client->name,
 			tbl_entry_throttle_client->freq[clk_min_level]);
-		*delta_cur -= now_cur_ma - min_cur_ma;
+		*delta_cur -= cand[i].saving_ma;
+		saved_ma += cand[i].saving_ma;
 
 		/* Store this client for bookkeeping */
-		tc_data = kzalloc(sizeof(*tc_data), GFP_KERNEL);
-		if (IS_ERR_OR_NULL(tc_data)) {
-			d_mpr_e("%s: Failed to allocate memory\n", __func__);
-			return -ENOMEM;
-		}
-		tc_data->table_id = i;
-		tc_data->delta_cu_ma = now_cur_ma - min_cur_ma;
+		tc_data->table_id = cand[i].table_id;
+		tc_data->delta_cu_ma = cand[i].saving_ma;
 		tc_data->prev_vdd_level = tbl_entry_throttle_client->vdd_level;
 		// Add throttled client to list to access it later
 		list_add_tail(&tc_data->list, &sinfo->throttled_clients);
+		sinfo->throttled_clients_cnt++;
+
+		mmrm_sw_account_client(sinfo, tbl_entry_throttle_client, false);
 
 		/* Store the throttled clock rate of client */
 		tbl_entry_throttle_client->clk_rate =
@@ -603,10 +774,31 @@ static int mmrm_sw_throttle_low_priority_client(
 		/* Store the corner level of throttled client */
 		tbl_entry_throttle_client->vdd_level = clk_min_level;
 
+		mmrm_sw_account_client(sinfo, tbl_entry_throttle_client, true);
+
 		/* Clearing the reserve flag */
 		tbl_entry_throttle_client->reserve = false;
 	}
+
 err_clk_set_fail:
+	if (!saved_ma)
+		return rc;
+
+	sinfo->throttle_cnt++;
+	if (rc) {
+		/*
+		 * Clients throttled before the failure stay throttled and on
+		 * the list, the request goes ahead if they already cover it.
+		 * Otherwise it is rejected and the saving is still accounted.
+		 */
+		if (*delta_cur < 0) {
+			d_mpr_h("%s: partial throttle covers delta_cur(%d)\n",
+				__func__, *delta_cur);
+			rc = 0;
+		} else {
+			peak_data->aggreg_val -= min(saved_ma, peak_data->aggreg_val);
+		}
+	}
 	return rc;
 }
 
@@ -615,9 +807,13 @@ static void mmrm_sw_dump_enabled_client_info(struct mmrm_sw_clk_mgr_info *sinfo)
 	u32 c;
 	struct mmrm_sw_peak_current_data *peak_data = &sinfo->peak_cur_data;
 	struct mmrm_sw_clk_client_tbl_entry *tbl_entry = NULL;
+	u32 sum_cur = 0;
 
 	for (c = 0; c < sinfo->tot_clk_clients; c++) {
 		tbl_entry = &sinfo->clk_client_tbl[c];
+		if (mmrm_sw_client_enabled(tbl_entry))
+			sum_cur += tbl_entry->current_ma[tbl_entry->vdd_level]
+				[peak_data->aggreg_level] * tbl_entry->num_hw_blocks;
 		if (tbl_entry->clk_rate) {
 			d_mpr_e("%s: csid(0x%x) clk_rate(%zu) vdd_level(%zu) cur_ma(%zu) num_hw_blocks(%zu)\n",
 				__func__,
@@ -632,6 +828,11 @@ static void mmrm_sw_dump_enabled_client_info(struct mmrm_sw_clk_mgr_info *sinfo)
 	if (peak_data) {
 		d_mpr_e("%s: aggreg_val(%zu) aggreg_level(%zu)\n", __func__,
 			peak_data->aggreg_val, peak_data->aggreg_level);
+		if (sum_cur != peak_data->level_cur_ma[peak_data->aggreg_level])
+			d_mpr_e("%s: level_cur_ma(%zu) out of sync, expected %zu\n",
+				__func__,
+				peak_data->level_cur_ma[peak_data->aggreg_level],
+				sum_cur);
 	}
 }
 
@@ -642,10 +843,19 @@ static int mmrm_reinstate_throttled_client(struct mmrm_sw_clk_mgr_info *sinfo) {
 	struct mmrm_sw_clk_client_tbl_entry *re_entry_throttle_client;
 	int rc =  0;
 	u64 start_ts = 0, end_ts = 0;
+	u32 hyst_ma, budget_ma;
+
+	/*
+	 * Reinstate only with some headroom left below the threshold, and
+	 * count each reinstated client against it, so that a client is not
+	 * restored and throttled again on the next small rate increase
+	 */
+	hyst_ma = peak_data->threshold * MMRM_SW_REINSTATE_HYST_PCT / 100;
+	budget_ma = peak_data->aggreg_val;
 
 	list_for_each_entry_safe(iter, safe_iter, &sinfo->throttled_clients, list) {
-		if (!IS_ERR_OR_NULL(iter) && peak_data->aggreg_val +
-			iter->delta_cu_ma <= peak_data->threshold) {
+		if (!IS_ERR_OR_NULL(iter) && budget_ma + iter->delta_cu_ma +
+			hyst_ma <= peak_data->threshold) {
 
 			d_mpr_h("%s: table_id = %d\n", __func__, iter->table_id);
 
@@ -683,6 +893,9 @@ static int mmrm_reinstate_throttled_client(struct mmrm_sw_clk_mgr_info *sinfo) {
 						d_mpr_e("%s: Client notifier took %llu ns\n",
 							__func__, (end_ts - start_ts));
 				}
+				budget_ma += iter->delta_cu_ma;
+				sinfo->reinstate_cnt++;
+				sinfo->throttled_clients_cnt--;
 				list_del(&iter->list);
 				kfree(iter);
 			}
@@ -704,7 +917,7 @@ static int mmrm_sw_check_peak_current(struct mmrm_sw_clk_mgr_info *sinfo,
 	int delta_cur = 0;
 
 	/* check the req level and adjust according to tbl entries */
-	rc = mmrm_sw_check_req_level(sinfo, tbl_entry->clk_src_id, req_level, &adj_level);
+	rc = mmrm_sw_check_req_level(sinfo, tbl_entry, req_level, &adj_level);
 	if (rc) {
 		goto err_invalid_level;
 	}
@@ -755,7 +968,8 @@ static int mmrm_sw_check_peak_current(struct mmrm_sw_clk_mgr_info *sinfo,
 
 		if ((tbl_entry->pri == MMRM_CLIENT_PRIOR_HIGH)
 			&& (msm_mmrm_enable_throttle_feature > 0)) {
-			rc = mmrm_sw_throttle_low_priority_client(sinfo, &delta_cur);
+			rc = mmrm_sw_throttle_low_priority_client(sinfo,
+				tbl_entry, &delta_cur);
 			if (rc != 0) {
 				d_mpr_e("%s: Failed to throttle the low priority client\n",
 						__func__);
@@ -895,10 +1109,12 @@ static int mmrm_sw_clk_client_setval(struct mmrm_clk_mgr *sw_clk_mgr,
 	}
 
 	/* update table entry */
+	mmrm_sw_account_client(sinfo, tbl_entry, false);
 	tbl_entry->clk_rate = clk_val;
 	tbl_entry->vdd_level = req_level;
 	tbl_entry->reserve = req_reserve;
 	tbl_entry->num_hw_blocks = client_data->num_hw_blocks;
+	mmrm_sw_account_client(sinfo, tbl_entry, true);
 
 	mutex_unlock(&sw_clk_mgr->lock);
 
@@ -1021,6 +1237,14 @@ static int mmrm_sw_clk_print_enabled_client_info(struct mmrm_clk_mgr *sw_clk_mgr
 			len = scnprintf(buf, left_spaces, "aggreg_val(%zu) aggreg_level(%zu)\n",
 				peak_data->aggreg_val, peak_data->aggreg_level);
 			left_spaces -= len;
+			buf += len;
+		}
+		if (left_spaces > 1) {
+			len = scnprintf(buf, left_spaces,
+				"throttle_cnt(%u) throttled_clients(%u) reinstate_cnt(%u)\n",
+				sinfo->throttle_cnt, sinfo->throttled_clients_cnt,
+				sinfo->reinstate_cnt);
+			left_spaces -= len;
 		}
 	}
 	return (sz - left_spaces);
@@ -1159,6 +1383,7 @@ int mmrm_destroy_sw_clk_mgr(struct mmrm_clk_mgr *sw_clk_mgr)
 		list_del(&iter->list);
 		kfree(iter);
 	}
+	sinfo->throttled_clients_cnt = 0;
 
 	if (!sw_clk_mgr) {
 		d_mpr_e("%s: sw_clk_mgr null\n", __func__);